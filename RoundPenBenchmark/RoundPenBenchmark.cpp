@@ -0,0 +1,268 @@
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core/core.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define CVUI_IMPLEMENTATION
+#include "../RoundPenConfigurator/cvui.h"
+#include "../RoundPenConfigurator/HistogramModel.h"
+#include "../RoundPenConfigurator/MarkerClassifier.h"
+
+using namespace std;
+
+const int benchWidth = 1920;
+const int benchHeight = 1080;
+const int benchRuns = 15;
+// Size of the display canvas of the configurator for a 16:9 video.
+const int displayWidth = 1900;
+const int displayHeight = 1069;
+// UI calls per run, a single call is too short to time.
+const int uiCallsPerRun = 100;
+
+// One measurement for the JSON output.
+struct BenchResult {
+	string name;
+	// Further JSON members describing the case, e.g. "\"markers\":4".
+	string params;
+	double medianMs;
+};
+
+static vector<BenchResult> results;
+
+static void addResult(const string& name, const string& params, double ms)
+{
+	BenchResult result = { name, params, ms };
+	results.push_back(result);
+}
+
+static string sizeParam(int width, int height)
+{
+	ostringstream param;
+	param << "\"width\":" << width << ",\"height\":" << height;
+	return param.str();
+}
+
+static bool writeJson(const char* path)
+{
+	ofstream out(path, ios::out | ios::trunc);
+	out << "{\n\"opencv\":\"" << CV_VERSION << "\",\n\"runs\":" << benchRuns << ",\n\"results\":[\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		out << "{\"name\":\"" << results[i].name << "\"," << results[i].params << ",\"median_ms\":" << results[i].medianMs << "}"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "]\n}\n";
+	out.close();
+	return !out.fail();
+}
+
+// Median run time in milliseconds of fn after one warm up run.
+template <typename F>
+static double medianMs(F fn)
+{
+	vector<double> times;
+	fn();
+	for (int i = 0; i < benchRuns; i++) {
+		int64 start = cv::getTickCount();
+		fn();
+		times.push_back((cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+	}
+	sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+// Compares every instruction set against the generic scalar kernel.
+// Returns false and prints the case on the first difference.
+static bool verifyKernels(const MarkerClassifier& reference, const cv::Mat& hsv, const char* name)
+{
+	const char* isaNames[] = { "scalar", "SSE2", "AVX2" };
+	cv::Mat expected, labels;
+	reference.classifyGeneric(hsv, expected);
+	MarkerClassifier classifier = reference;
+	for (int isa = CLASSIFIER_SCALAR; isa <= CLASSIFIER_AVX2; isa++) {
+		if (!classifier.setIsa((ClassifierIsa)isa)) {
+			continue;
+		}
+		classifier.classify(hsv, labels);
+		for (int y = 0; y < hsv.rows; y++) {
+			if (memcmp(expected.ptr(y), labels.ptr(y), hsv.cols) != 0) {
+				cerr << isaNames[isa] << " kernel differs from the scalar reference on " << name
+					<< " with " << reference.markers() << " markers" << endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Display resize and HSV conversion of a full HD and a 4K frame.
+static void benchImageOps(cv::RNG& rng)
+{
+	const int sizes[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	printf("Image operations, median of %d runs in ms\n", benchRuns);
+	for (int i = 0; i < 2; i++) {
+		cv::Mat bgr(sizes[i][1], sizes[i][0], CV_8UC3);
+		rng.fill(bgr, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+		cv::Mat dst;
+		double resizeMs = medianMs([&]() { cv::resize(bgr, dst, cv::Size(displayWidth, displayHeight)); });
+		double hsvMs = medianMs([&]() { cv::cvtColor(bgr, dst, cv::COLOR_BGR2HSV); });
+		printf("%dx%d  resize to display %7.2f  cvtColor BGR2HSV %7.2f\n", sizes[i][0], sizes[i][1], resizeMs, hsvMs);
+		addResult("resize_display", sizeParam(sizes[i][0], sizes[i][1]), resizeMs);
+		addResult("cvtcolor_bgr2hsv", sizeParam(sizes[i][0], sizes[i][1]), hsvMs);
+	}
+}
+
+// cvui drawing on a canvas the size of the configurator window.
+static void benchUi()
+{
+	cv::Mat canvas(displayHeight + 200, displayWidth, CV_8UC3, cv::Scalar::all(40));
+	double alphaMs = medianMs([&]() {
+		for (int i = 0; i < uiCallsPerRun; i++) {
+			cvui::rect(canvas, 100 + i, 100, 200, 150, 0xff0000, 0xeeff0000);
+		}
+	});
+	double opaqueMs = medianMs([&]() {
+		for (int i = 0; i < uiCallsPerRun; i++) {
+			cvui::rect(canvas, 100 + i, 100, 16, 16, 0, 0xff00ff00);
+		}
+	});
+	double textMs = medianMs([&]() {
+		for (int i = 0; i < uiCallsPerRun; i++) {
+			cvui::text(canvas, 10, displayHeight + 20, "Click on a pixel in the window to define a new marker.");
+		}
+	});
+	// Same text with the size measured once and kept.
+	cvui::retained(true);
+	double retainedMs = medianMs([&]() {
+		for (int i = 0; i < uiCallsPerRun; i++) {
+			cvui::text(canvas, 10, displayHeight + 20, "Click on a pixel in the window to define a new marker.");
+		}
+	});
+	cvui::retained(false);
+	printf("cvui, %d calls: rect alpha %7.2f  rect opaque %7.2f  text %7.2f  text retained %7.2f\n", uiCallsPerRun, alphaMs, opaqueMs, textMs, retainedMs);
+	ostringstream params;
+	params << "\"calls\":" << uiCallsPerRun;
+	addResult("cvui_rect_alpha", params.str(), alphaMs);
+	addResult("cvui_rect_opaque", params.str(), opaqueMs);
+	addResult("cvui_text", params.str(), textMs);
+	addResult("cvui_text_retained", params.str(), retainedMs);
+}
+
+// Histogram back-projection through the lookup table.
+static void benchBackProjection(cv::RNG& rng, const cv::Mat& hsv)
+{
+	const int markers = 4;
+	HistogramModel background;
+	vector<HistogramModel> models(markers);
+	for (int i = 0; i < 2000; i++) {
+		cv::Vec3b sample((uchar)rng.uniform(0, 180), (uchar)rng.uniform(0, 256), (uchar)rng.uniform(0, 256));
+		if (i % 2 == 0) {
+			background.addSample(sample);
+		}
+		else {
+			models[i % markers].addSample(sample);
+		}
+	}
+	BackProjectionLut lut;
+	double buildMs = medianMs([&]() { lut.build(background, models.data(), markers); });
+	cv::Mat labels;
+	double classifyMs = medianMs([&]() { lut.classify(hsv, labels); });
+	printf("Back-projection, %d markers: build %7.2f  classify %dx%d %7.2f\n", markers, buildMs, benchWidth, benchHeight, classifyMs);
+	ostringstream params;
+	params << "\"markers\":" << markers;
+	addResult("backprojection_build", params.str(), buildMs);
+	addResult("backprojection_classify", sizeParam(benchWidth, benchHeight) + "," + params.str(), classifyMs);
+}
+
+int main(int argc, char** argv)
+{
+	// Results also go to a JSON file to compare versions.
+	const char* jsonPath = "benchmark.json";
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--json=", 7) == 0) {
+			jsonPath = argv[i] + 7;
+		}
+	}
+
+	// Fixed seed so every run classifies the same image.
+	cv::RNG rng(0x5eed);
+	cv::Mat hsv(benchHeight, benchWidth, CV_8UC3);
+	rng.fill(hsv, cv::RNG::UNIFORM, cv::Scalar(0, 0, 0), cv::Scalar(180, 256, 256));
+
+	// Red pens sit on both sides of the hue wrap. Every pixel of this image
+	// has a hue of 170..179 or 0..9 and must go to the nearest red marker.
+	cv::Mat red(64, benchWidth, CV_8UC3);
+	rng.fill(red, cv::RNG::UNIFORM, cv::Scalar(0, 150, 150), cv::Scalar(20, 256, 256));
+	for (int y = 0; y < red.rows; y++) {
+		for (int x = 0; x < red.cols; x++) {
+			uchar& h = red.at<cv::Vec3b>(y, x)[0];
+			h = h < 10 ? h : h + 160;
+		}
+	}
+	cv::Vec3b redMarkers[3] = { cv::Vec3b(177, 200, 200), cv::Vec3b(3, 200, 200), cv::Vec3b(120, 200, 200) };
+	MarkerClassifier redClassifier;
+	redClassifier.setColors(cv::Vec3b(60, 40, 40), redMarkers, 3);
+	if (!verifyKernels(redClassifier, red, "red hues")) {
+		return -1;
+	}
+	cv::Mat redLabels;
+	redClassifier.classifyGeneric(red, redLabels);
+	for (int y = 0; y < red.rows; y++) {
+		for (int x = 0; x < red.cols; x++) {
+			int h = red.at<cv::Vec3b>(y, x)[0];
+			int expected = (h >= 170 || h == 0) ? 1 : 2;
+			if (redLabels.at<uchar>(y, x) != expected) {
+				cerr << "Scalar reference does not wrap hue " << h << endl;
+				return -1;
+			}
+		}
+	}
+
+	benchImageOps(rng);
+	benchUi();
+	benchBackProjection(rng, hsv);
+
+	const char* isaNames[] = { "specialized", "sse2", "avx2" };
+	cv::Mat labels;
+	printf("Classification of %dx%d HSV pixels, median of %d runs in ms\n", benchWidth, benchHeight, benchRuns);
+	printf("markers   generic  specialized     SSE2     AVX2\n");
+	for (int n = 1; n <= maxSpecializedMarkers; n++) {
+		vector<cv::Vec3b> colors(n);
+		for (int i = 0; i < n; i++) {
+			colors[i] = cv::Vec3b((uchar)rng.uniform(0, 180), (uchar)rng.uniform(0, 256), (uchar)rng.uniform(0, 256));
+		}
+		MarkerClassifier classifier;
+		classifier.setColors(cv::Vec3b(0, 0, 0), colors.data(), n);
+		if (!verifyKernels(classifier, hsv, "random pixels")) {
+			return -1;
+		}
+
+		double times[CLASSIFIER_AVX2 + 1];
+		for (int isa = CLASSIFIER_SCALAR; isa <= CLASSIFIER_AVX2; isa++) {
+			times[isa] = classifier.setIsa((ClassifierIsa)isa) ? medianMs([&]() { classifier.classify(hsv, labels); }) : 0;
+		}
+		double generic = medianMs([&]() { classifier.classifyGeneric(hsv, labels); });
+		printf("%7d  %8.2f  %11.2f  %7.2f  %7.2f\n", n, generic, times[CLASSIFIER_SCALAR], times[CLASSIFIER_SSE2], times[CLASSIFIER_AVX2]);
+
+		ostringstream params;
+		params << sizeParam(benchWidth, benchHeight) << ",\"markers\":" << n << ",\"kernel\":";
+		addResult("classify", params.str() + "\"generic\"", generic);
+		for (int isa = CLASSIFIER_SCALAR; isa <= CLASSIFIER_AVX2; isa++) {
+			// 0 means the CPU lacks the instruction set.
+			if (times[isa] > 0) {
+				addResult("classify", params.str() + "\"" + isaNames[isa] + "\"", times[isa]);
+			}
+		}
+	}
+
+	if (!writeJson(jsonPath)) {
+		cerr << "Error writing " << jsonPath << endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,260 @@
+#include "BitMask.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define BITMASK_SSE2 1
+	#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+static inline int popcount64(uint64_t v)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(v);
+#elif defined(__GNUC__)
+	return __builtin_popcountll(v);
+#else
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// One row of the separable 3x3 operation: every pixel is combined with its
+// left and right neighbour, 64 pixels per word. Bits crossing a word border
+// are carried over from the neighbouring words.
+static inline void horizontal(const uint64_t* src, uint64_t* dst, int n, uint64_t tailMask, bool erode)
+{
+	const uint64_t outside = erode ? ~(uint64_t)0 : 0;
+	// Padding bits of the last word behave like pixels outside the mask.
+	const uint64_t pad = outside & ~tailMask;
+	uint64_t prev = outside;
+	uint64_t w = n == 1 ? (src[0] | pad) : src[0];
+	for (int i = 0; i < n; i++) {
+		uint64_t next = i + 1 < n ? src[i + 1] : outside;
+		if (i + 1 == n - 1) {
+			next |= pad;
+		}
+		uint64_t left = (w << 1) | (prev >> 63);
+		uint64_t right = (w >> 1) | (next << 63);
+		dst[i] = erode ? (w & left & right) : (w | left | right);
+		prev = w;
+		w = next;
+	}
+}
+
+BitMask::BitMask() : rows(0), cols(0), wordsPerRow(0), tailMask(0)
+{
+}
+
+BitMask::BitMask(int rows, int cols) : rows(0), cols(0), wordsPerRow(0), tailMask(0)
+{
+	create(rows, cols);
+}
+
+void BitMask::create(int rows, int cols)
+{
+	this->rows = rows;
+	this->cols = cols;
+	wordsPerRow = (cols + 63) / 64;
+	tailMask = (cols & 63) ? (((uint64_t)1 << (cols & 63)) - 1) : ~(uint64_t)0;
+	words.resize((size_t)rows * wordsPerRow);
+}
+
+void BitMask::clear()
+{
+	std::fill(words.begin(), words.end(), 0);
+}
+
+size_t BitMask::area() const
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < words.size(); i++) {
+		sum += popcount64(words[i]);
+	}
+	return sum;
+}
+
+size_t BitMask::moments(double& sumX, double& sumY) const
+{
+	// Bit k of the position within the word is set in indexBits[k], so the
+	// positions of all set bits of a word add up from six popcounts.
+	static const uint64_t indexBits[6] = {
+		0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+		0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+	};
+	size_t total = 0;
+	sumX = 0;
+	sumY = 0;
+	for (int y = 0; y < rows; y++) {
+		const uint64_t* r = row(y);
+		uint64_t rowCount = 0;
+		uint64_t rowX = 0;
+		for (int i = 0; i < wordsPerRow; i++) {
+			uint64_t w = r[i];
+			if (w == 0) {
+				continue;
+			}
+			uint64_t n = popcount64(w);
+			rowCount += n;
+			rowX += n * 64 * (uint64_t)i;
+			for (int k = 0; k < 6; k++) {
+				rowX += (uint64_t)popcount64(w & indexBits[k]) << k;
+			}
+		}
+		total += (size_t)rowCount;
+		sumX += (double)rowX;
+		sumY += (double)rowCount * y;
+	}
+	return total;
+}
+
+void BitMask::fromMat(const cv::Mat& src, BitMask& dst)
+{
+	CV_Assert(src.type() == CV_8UC1);
+	dst.create(src.rows, src.cols);
+	for (int y = 0; y < src.rows; y++) {
+		const uchar* s = src.ptr<uchar>(y);
+		uint64_t* d = dst.row(y);
+		memset(d, 0, dst.wordsPerRow * sizeof(uint64_t));
+		int x = 0;
+#ifdef BITMASK_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 64 <= src.cols; x += 64) {
+			uint64_t w = 0;
+			for (int k = 0; k < 4; k++) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(s + x + 16 * k));
+				int isZero = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+				w |= (uint64_t)(~isZero & 0xffff) << (16 * k);
+			}
+			d[x >> 6] = w;
+		}
+#endif
+		for (; x < src.cols; x++) {
+			if (s[x]) {
+				d[x >> 6] |= (uint64_t)1 << (x & 63);
+			}
+		}
+	}
+}
+
+void BitMask::toMat(cv::Mat& dst) const
+{
+	dst.create(rows, cols, CV_8UC1);
+	for (int y = 0; y < rows; y++) {
+		const uint64_t* s = row(y);
+		uchar* d = dst.ptr<uchar>(y);
+		for (int x = 0; x < cols; x++) {
+			d[x] = ((s[x >> 6] >> (x & 63)) & 1) ? 255 : 0;
+		}
+	}
+}
+
+void BitMask::fromLabels(const cv::Mat& labels, int count, std::vector<BitMask>& masks)
+{
+	CV_Assert(labels.type() == CV_8UC1);
+	// Also drops the masks of labels a previous call had and this one has not.
+	masks.resize(count);
+	for (int i = 0; i < count; i++) {
+		masks[i].create(labels.rows, labels.cols);
+		masks[i].clear();
+	}
+	for (int y = 0; y < labels.rows; y++) {
+		const uchar* l = labels.ptr<uchar>(y);
+		for (int x = 0; x < labels.cols; x++) {
+			int label = l[x];
+			if (label != 0 && label <= count) {
+				masks[label - 1].row(y)[x >> 6] |= (uint64_t)1 << (x & 63);
+			}
+		}
+	}
+}
+
+void BitMask::morph(const BitMask& src, BitMask& dst, bool erode)
+{
+	if (&dst != &src) {
+		dst.create(src.rows, src.cols);
+	}
+	const int n = src.wordsPerRow;
+	if (src.rows == 0 || n == 0) {
+		return;
+	}
+	const uint64_t outside = erode ? ~(uint64_t)0 : 0;
+
+	// Horizontal results of the rows above, at and below the current one.
+	// Row y + 1 is read before row y is written, so this also works in place.
+	static thread_local std::vector<uint64_t> ring;
+	ring.resize(3 * (size_t)n);
+	uint64_t* prev = &ring[0];
+	uint64_t* cur = &ring[n];
+	uint64_t* next = &ring[2 * n];
+
+	std::fill(prev, prev + n, outside);
+	horizontal(src.row(0), cur, n, src.tailMask, erode);
+	for (int y = 0; y < src.rows; y++) {
+		if (y + 1 < src.rows) {
+			horizontal(src.row(y + 1), next, n, src.tailMask, erode);
+		}
+		else {
+			std::fill(next, next + n, outside);
+		}
+		uint64_t* out = dst.row(y);
+		if (erode) {
+			for (int i = 0; i < n; i++) {
+				out[i] = prev[i] & cur[i] & next[i];
+			}
+		}
+		else {
+			for (int i = 0; i < n; i++) {
+				out[i] = prev[i] | cur[i] | next[i];
+			}
+		}
+		out[n - 1] &= src.tailMask;
+
+		uint64_t* tmp = prev;
+		prev = cur;
+		cur = next;
+		next = tmp;
+	}
+}
+
+void BitMask::erode(const BitMask& src, BitMask& dst, int iterations)
+{
+	const BitMask* in = &src;
+	for (int i = 0; i < iterations; i++) {
+		morph(*in, dst, true);
+		in = &dst;
+	}
+	if (iterations <= 0 && &dst != &src) {
+		dst = src;
+	}
+}
+
+void BitMask::dilate(const BitMask& src, BitMask& dst, int iterations)
+{
+	const BitMask* in = &src;
+	for (int i = 0; i < iterations; i++) {
+		morph(*in, dst, false);
+		in = &dst;
+	}
+	if (iterations <= 0 && &dst != &src) {
+		dst = src;
+	}
+}
+
+void BitMask::open(const BitMask& src, BitMask& dst, int iterations)
+{
+	erode(src, dst, iterations);
+	dilate(dst, dst, iterations);
+}
+
+void BitMask::close(const BitMask& src, BitMask& dst, int iterations)
+{
+	dilate(src, dst, iterations);
+	erode(dst, dst, iterations);
+}
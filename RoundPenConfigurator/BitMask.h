@@ -0,0 +1,64 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <vector>
+
+// Binary mask with one bit per pixel.
+// Pixel x of a row lives in bit (x % 64) of word (x / 64), so the left
+// neighbour of a pixel is one bit lower and the right neighbour one bit higher.
+// Rows are padded to whole 64-bit words and the padding bits are always 0.
+class BitMask {
+public:
+	BitMask();
+	BitMask(int rows, int cols);
+
+	// Reallocates the mask if the size changed. Content is undefined afterwards.
+	void create(int rows, int cols);
+	// Sets every pixel to 0.
+	void clear();
+
+	uint64_t* row(int y) { return &words[(size_t)y * wordsPerRow]; }
+	const uint64_t* row(int y) const { return &words[(size_t)y * wordsPerRow]; }
+
+	bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+	void set(int x, int y) { row(y)[x >> 6] |= (uint64_t)1 << (x & 63); }
+
+	// Number of set pixels.
+	size_t area() const;
+	// Number of set pixels and the sums of their x and y, e.g. for the
+	// centroid, counted on the packed words.
+	size_t moments(double& sumX, double& sumY) const;
+
+	// Packs a CV_8UC1 Mat, every non zero byte becomes a set pixel.
+	static void fromMat(const cv::Mat& src, BitMask& dst);
+	// Unpacks into a CV_8UC1 Mat with 0 and 255.
+	void toMat(cv::Mat& dst) const;
+
+	// Splits a CV_8UC1 label image into one mask per label in a single pass.
+	// Label 0 is ignored, label i (1..count) goes to masks[i - 1].
+	// masks ends up with exactly count masks.
+	static void fromLabels(const cv::Mat& labels, int count, std::vector<BitMask>& masks);
+
+	// 3x3 square morphology, repeated `iterations` times.
+	// Pixels outside the mask count as set for erode and unset for dilate,
+	// which matches the default border of cv::morphologyEx.
+	// src and dst may be the same mask.
+	static void erode(const BitMask& src, BitMask& dst, int iterations = 1);
+	static void dilate(const BitMask& src, BitMask& dst, int iterations = 1);
+	static void open(const BitMask& src, BitMask& dst, int iterations = 1);
+	static void close(const BitMask& src, BitMask& dst, int iterations = 1);
+
+	int rows;
+	int cols;
+	int wordsPerRow;
+	// Mask for the valid bits of the last word of a row.
+	uint64_t tailMask;
+	std::vector<uint64_t> words;
+
+private:
+	static void morph(const BitMask& src, BitMask& dst, bool erode);
+};
+
+#endif // BITMASK_H
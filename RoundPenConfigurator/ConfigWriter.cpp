@@ -0,0 +1,65 @@
+#include "ConfigWriter.h"
+
+#include "Trace.h"
+
+ConfigWriter::ConfigWriter(const std::string& basePath) : basePath(basePath), hasPending(false), stopping(false), finished(false), finishedOk(false)
+{
+	worker = std::thread(&ConfigWriter::run, this);
+}
+
+ConfigWriter::~ConfigWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	worker.join();
+}
+
+void ConfigWriter::save(const MarkerConfig& config)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = config;
+		hasPending = true;
+	}
+	wakeUp.notify_one();
+}
+
+bool ConfigWriter::poll(bool& ok)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!finished) {
+		return false;
+	}
+	ok = finishedOk;
+	finished = false;
+	return true;
+}
+
+void ConfigWriter::run()
+{
+	traceThreadName("config writer");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wakeUp.wait(lock, [this] { return hasPending || stopping; });
+		if (!hasPending) {
+			return;
+		}
+		MarkerConfig config;
+		std::swap(config, pending);
+		hasPending = false;
+		lock.unlock();
+
+		TRACE_SCOPE("save");
+		// Formatting includes building the lookup table, also done here.
+		bool ok = writeFileAtomic((basePath + ".csv").c_str(), formatCsv(config));
+		ok = writeFileAtomic((basePath + ".hist").c_str(), formatHistograms(config)) && ok;
+		ok = writeFileAtomic((basePath + ".bin").c_str(), formatBinary(config)) && ok;
+
+		lock.lock();
+		finished = true;
+		finishedOk = ok;
+	}
+}
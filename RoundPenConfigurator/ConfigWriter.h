@@ -0,0 +1,44 @@
+#ifndef CONFIGWRITER_H
+#define CONFIGWRITER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "MarkerConfig.h"
+
+// Saves marker configurations on a background thread, so the UI loop
+// does not wait for the disk. Every file is written atomically.
+class ConfigWriter {
+public:
+	// Writes basePath.csv, basePath.hist and basePath.bin.
+	explicit ConfigWriter(const std::string& basePath);
+	// Finishes a pending save before returning.
+	~ConfigWriter();
+
+	// Queues a copy of config. If the previous save has not started yet,
+	// it is replaced, only the latest configuration matters.
+	void save(const MarkerConfig& config);
+
+	// True once for every finished save, with its result in ok.
+	bool poll(bool& ok);
+
+private:
+	ConfigWriter(const ConfigWriter&);
+	ConfigWriter& operator=(const ConfigWriter&);
+
+	void run();
+
+	std::string basePath;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	MarkerConfig pending;
+	bool hasPending;
+	bool stopping;
+	bool finished;
+	bool finishedOk;
+	std::thread worker;
+};
+
+#endif // CONFIGWRITER_H
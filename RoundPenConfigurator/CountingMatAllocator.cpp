@@ -0,0 +1,44 @@
+#include "CountingMatAllocator.h"
+
+CountingMatAllocator::CountingMatAllocator() : parent(0), installed(false), count(0)
+{
+}
+
+cv::UMatData* CountingMatAllocator::allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+	count.fetch_add(1, std::memory_order_relaxed);
+	// The parent sets itself as allocator of the data, so deallocation does
+	// not come back here.
+	return parent->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+bool CountingMatAllocator::allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const
+{
+	return parent->allocate(data, accessFlags, usageFlags);
+}
+
+void CountingMatAllocator::deallocate(cv::UMatData* data) const
+{
+	parent->deallocate(data);
+}
+
+void CountingMatAllocator::install()
+{
+	if (!installed) {
+		// parent is kept after uninstall(), another thread may still be
+		// inside allocate().
+		if (parent == 0) {
+			parent = cv::Mat::getDefaultAllocator();
+		}
+		cv::Mat::setDefaultAllocator(this);
+		installed = true;
+	}
+}
+
+void CountingMatAllocator::uninstall()
+{
+	if (installed) {
+		cv::Mat::setDefaultAllocator(parent);
+		installed = false;
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef COUNTINGMATALLOCATOR_H
+#define COUNTINGMATALLOCATOR_H
+
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <stdint.h>
+
+// Mat allocator that counts the allocations and leaves the work to the
+// allocator that was the default before install().
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+	CountingMatAllocator();
+
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const;
+	bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const;
+	void deallocate(cv::UMatData* data) const;
+
+	// Makes this the default allocator for new Mats, or restores the previous one.
+	// Mats allocated meanwhile are freed by the previous allocator as before.
+	void install();
+	void uninstall();
+
+	uint64_t allocations() const { return count.load(std::memory_order_relaxed); }
+
+private:
+	cv::MatAllocator* parent;
+	bool installed;
+	mutable std::atomic<uint64_t> count;
+};
+
+#endif // COUNTINGMATALLOCATOR_H
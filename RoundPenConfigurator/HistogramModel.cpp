@@ -0,0 +1,141 @@
+#include "HistogramModel.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdlib.h>
+
+static inline int hueBin(int hue)
+{
+	return hue * histHueBins / 180;
+}
+
+static inline int satBin(int sat)
+{
+	return sat * histSatBins / 256;
+}
+
+HistogramModel::HistogramModel() : bins(histHueBins * histSatBins, 0), samples(0)
+{
+}
+
+void HistogramModel::clear()
+{
+	std::fill(bins.begin(), bins.end(), 0);
+	samples = 0;
+}
+
+void HistogramModel::addSample(const cv::Vec3b& hsv)
+{
+	bins[hueBin(hsv[0]) * histSatBins + satBin(hsv[1])]++;
+	samples++;
+}
+
+void HistogramModel::addPatch(const cv::Mat& hsv)
+{
+	CV_Assert(hsv.type() == CV_8UC3);
+	for (int y = 0; y < hsv.rows; y++) {
+		const cv::Vec3b* p = hsv.ptr<cv::Vec3b>(y);
+		for (int x = 0; x < hsv.cols; x++) {
+			addSample(p[x]);
+		}
+	}
+}
+
+float HistogramModel::probability(int hue, int sat) const
+{
+	if (samples == 0) {
+		return 0;
+	}
+	int hb = hueBin(hue);
+	int sb = satBin(sat);
+	uint32_t sum = 0;
+	for (int dh = -1; dh <= 1; dh++) {
+		// Hue wraps around, saturation does not.
+		int h = (hb + dh + histHueBins) % histHueBins;
+		for (int ds = -1; ds <= 1; ds++) {
+			int s = sb + ds;
+			if (s >= 0 && s < histSatBins) {
+				sum += bins[h * histSatBins + s];
+			}
+		}
+	}
+	return sum / (float)samples;
+}
+
+void HistogramModel::write(std::ostream& out, const std::string& name) const
+{
+	out << name << ";" << samples;
+	for (size_t i = 0; i < bins.size(); i++) {
+		out << ";" << bins[i];
+	}
+	out << "\n";
+}
+
+bool HistogramModel::read(const std::string& line)
+{
+	std::istringstream in(line);
+	std::string field;
+	if (!std::getline(in, field, ';')) {
+		return false;
+	}
+	samples = (uint32_t)strtoul(field.c_str(), NULL, 10);
+	for (size_t i = 0; i < bins.size(); i++) {
+		if (!std::getline(in, field, ';')) {
+			clear();
+			return false;
+		}
+		bins[i] = (uint32_t)strtoul(field.c_str(), NULL, 10);
+	}
+	return true;
+}
+
+BackProjectionLut::BackProjectionLut() : minProbability(defaultMinProbability), minValue(defaultMinValue), table(256 * 256, 0)
+{
+}
+
+void BackProjectionLut::build(const HistogramModel& background, const HistogramModel* markers, int count)
+{
+	CV_Assert(count >= 0 && count < 256);
+
+	// Decide per bin first, every pixel value of a bin gets the same label.
+	uchar binLabels[histHueBins * histSatBins];
+	for (int hb = 0; hb < histHueBins; hb++) {
+		for (int sb = 0; sb < histSatBins; sb++) {
+			int hue = hb * 180 / histHueBins;
+			int sat = sb * 256 / histSatBins;
+			float best = std::max(minProbability, background.probability(hue, sat));
+			uchar label = 0;
+			for (int i = 0; i < count; i++) {
+				float p = markers[i].probability(hue, sat);
+				if (p > best) {
+					best = p;
+					label = (uchar)(i + 1);
+				}
+			}
+			binLabels[hb * histSatBins + sb] = label;
+		}
+	}
+
+	// Hue only goes up to 179, the rest of the table stays 0.
+	table.assign(256 * 256, 0);
+	for (int hue = 0; hue < 180; hue++) {
+		for (int sat = 0; sat < 256; sat++) {
+			table[hue * 256 + sat] = binLabels[hueBin(hue) * histSatBins + satBin(sat)];
+		}
+	}
+}
+
+void BackProjectionLut::classify(const cv::Mat& hsv, cv::Mat& labels) const
+{
+	CV_Assert(hsv.type() == CV_8UC3);
+	labels.create(hsv.rows, hsv.cols, CV_8UC1);
+	const uchar* lut = &table[0];
+	for (int y = 0; y < hsv.rows; y++) {
+		const uchar* src = hsv.ptr<uchar>(y);
+		uchar* dst = labels.ptr<uchar>(y);
+		for (int x = 0; x < hsv.cols; x++) {
+			const uchar* p = src + 3 * x;
+			dst[x] = p[2] >= minValue ? lut[p[0] * 256 + p[1]] : 0;
+		}
+	}
+}
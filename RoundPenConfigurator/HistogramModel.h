@@ -0,0 +1,67 @@
+#ifndef HISTOGRAMMODEL_H
+#define HISTOGRAMMODEL_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Bins of the H-S histograms. Hue 0..179 goes into 30 bins of 6,
+// saturation 0..255 into 32 bins of 8.
+const int histHueBins = 30;
+const int histSatBins = 32;
+
+// Thresholds of a new BackProjectionLut.
+const float defaultMinProbability = 0.05f;
+const int defaultMinValue = 30;
+
+// Colour model of one marker (or the background) as a 2D hue/saturation
+// histogram of sampled pixels. Value is left out so the model holds up
+// under changing brightness.
+class HistogramModel {
+public:
+	HistogramModel();
+
+	void clear();
+	void addSample(const cv::Vec3b& hsv);
+	// Adds every pixel of a CV_8UC3 HSV patch.
+	void addPatch(const cv::Mat& hsv);
+
+	// Fraction of the samples in the bin of (hue, sat) and its 8 neighbours,
+	// so a few clicks also cover slightly different shades.
+	float probability(int hue, int sat) const;
+
+	// Writes "name;samples;bin0;bin1;..." as one line.
+	void write(std::ostream& out, const std::string& name) const;
+	// Parses the part after the name of a line written by write().
+	bool read(const std::string& line);
+
+	// histHueBins * histSatBins counts, hue major.
+	std::vector<uint32_t> bins;
+	uint32_t samples;
+};
+
+// Lookup table for histogram back-projection of all markers at once.
+// For every (hue, sat) pair it stores the label of the most probable marker,
+// or 0 if the background is more probable or no marker is probable enough.
+// Classifying an image is then a single table lookup per pixel.
+class BackProjectionLut {
+public:
+	BackProjectionLut();
+
+	// Markers get the labels 1..count.
+	void build(const HistogramModel& background, const HistogramModel* markers, int count);
+
+	// Labels a CV_8UC3 HSV image into a CV_8UC1 image in one pass.
+	void classify(const cv::Mat& hsv, cv::Mat& labels) const;
+
+	// A marker needs at least this probability to be picked.
+	float minProbability;
+	// Darker pixels carry no reliable hue and are always labelled 0.
+	int minValue;
+	// 256 * 256 labels, indexed by hue * 256 + sat.
+	std::vector<uchar> table;
+};
+
+#endif // HISTOGRAMMODEL_H
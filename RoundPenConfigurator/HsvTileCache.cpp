@@ -0,0 +1,49 @@
+#include "HsvTileCache.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "Trace.h"
+
+HsvTileCache::HsvTileCache() : tilesX(0), tilesY(0), converted(0)
+{
+}
+
+void HsvTileCache::reset(const cv::Mat& bgr)
+{
+	CV_Assert(bgr.type() == CV_8UC3);
+	this->bgr = bgr;
+	hsv.create(bgr.rows, bgr.cols, CV_8UC3);
+	tilesX = (bgr.cols + hsvTileSize - 1) / hsvTileSize;
+	tilesY = (bgr.rows + hsvTileSize - 1) / hsvTileSize;
+	tileReady.assign(tilesX * tilesY, false);
+	converted = 0;
+}
+
+cv::Mat HsvTileCache::region(const cv::Rect& rect)
+{
+	cv::Rect clipped = rect & cv::Rect(0, 0, bgr.cols, bgr.rows);
+	if (clipped.area() == 0) {
+		return cv::Mat();
+	}
+	int lastTileX = (clipped.x + clipped.width - 1) / hsvTileSize;
+	int lastTileY = (clipped.y + clipped.height - 1) / hsvTileSize;
+	for (int ty = clipped.y / hsvTileSize; ty <= lastTileY; ty++) {
+		for (int tx = clipped.x / hsvTileSize; tx <= lastTileX; tx++) {
+			if (!tileReady[ty * tilesX + tx]) {
+				cv::Rect tile = cv::Rect(tx * hsvTileSize, ty * hsvTileSize, hsvTileSize, hsvTileSize) & cv::Rect(0, 0, bgr.cols, bgr.rows);
+				TRACE_SCOPE("cvtColor tile");
+				// Writes into the tile of hsv, the sizes already match.
+				cv::Mat dst = hsv(tile);
+				cv::cvtColor(bgr(tile), dst, cv::COLOR_BGR2HSV);
+				tileReady[ty * tilesX + tx] = true;
+				converted++;
+			}
+		}
+	}
+	return hsv(clipped);
+}
+
+cv::Vec3b HsvTileCache::at(const cv::Point& pos)
+{
+	return region(cv::Rect(pos.x, pos.y, 1, 1)).at<cv::Vec3b>(0, 0);
+}
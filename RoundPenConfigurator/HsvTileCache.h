@@ -0,0 +1,37 @@
+#ifndef HSVTILECACHE_H
+#define HSVTILECACHE_H
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+// Edge length of the tiles converted at once.
+const int hsvTileSize = 64;
+
+// HSV version of a BGR image that is converted tile by tile on first access.
+// Picking colours touches only a few tiles, so a 4K crop does not have to
+// be converted as a whole.
+class HsvTileCache {
+public:
+	HsvTileCache();
+
+	// Forgets all converted tiles. bgr must stay valid while the cache is used.
+	void reset(const cv::Mat& bgr);
+
+	// HSV pixels of rect clipped to the image, converting missing tiles first.
+	cv::Mat region(const cv::Rect& rect);
+	cv::Vec3b at(const cv::Point& pos);
+
+	int convertedTiles() const { return converted; }
+	int totalTiles() const { return tilesX * tilesY; }
+
+private:
+	cv::Mat bgr;
+	// Only the converted tiles hold valid values.
+	cv::Mat hsv;
+	std::vector<bool> tileReady;
+	int tilesX;
+	int tilesY;
+	int converted;
+};
+
+#endif // HSVTILECACHE_H
@@ -0,0 +1,61 @@
+#include "InputQueue.h"
+
+#include <deque>
+
+#include "InputReplay.h"
+#include "Trace.h"
+
+struct QueuedKey {
+	int key;
+	int64_t arrived;
+};
+
+static std::deque<QueuedKey> keys;
+// Keys taken from the queue and not shown yet.
+static std::deque<int64_t> handled;
+// Arrival of the first mouse event since the last frame was shown, 0 if none.
+static int64_t mouseArrived = 0;
+
+void inputPoll(int delay)
+{
+	int key = inputWaitKey(delay);
+	for (int i = 0; key != -1; i++) {
+		QueuedKey queued = { key, traceNow() };
+		keys.push_back(queued);
+		if (i + 1 == maxKeysPerPoll) {
+			break;
+		}
+		key = inputWaitKey(1);
+	}
+}
+
+bool inputNextKey(int& key)
+{
+	if (keys.empty()) {
+		return false;
+	}
+	key = keys.front().key;
+	handled.push_back(keys.front().arrived);
+	keys.pop_front();
+	return true;
+}
+
+void inputMouseArrived()
+{
+	if (mouseArrived == 0) {
+		mouseArrived = traceNow();
+	}
+}
+
+void inputShown()
+{
+	int64_t now = traceNow();
+	for (size_t i = 0; i < handled.size(); i++) {
+		traceRecord("input latency", handled[i], now);
+	}
+	handled.clear();
+	if (mouseArrived != 0) {
+		traceRecord("input latency", mouseArrived, now);
+		mouseArrived = 0;
+	}
+}
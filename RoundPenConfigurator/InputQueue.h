@@ -0,0 +1,29 @@
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include <stdint.h>
+
+// Keys of the configurator window in arrival order. cv::waitKey() hands out
+// one key per call and some backends only keep the last one, so keys typed
+// while a frame takes long could get lost. inputPoll() drains every pending
+// key right after the wait of the frame and the loop handles all of them
+// in the same iteration.
+
+// Keys drained per poll at most, the rest waits for the next frame.
+const int maxKeysPerPoll = 32;
+
+// Waits like inputWaitKey(delay), then takes every further pending key.
+void inputPoll(int delay);
+// Next queued key, false if the queue is empty.
+bool inputNextKey(int& key);
+
+// Called by the mouse callback, for the latency of mouse input.
+void inputMouseArrived();
+// Call once the frame showing the effect of the handled input is displayed.
+// Records the time from the arrival of each key and of the first mouse
+// event since the last frame until now as "input latency" span.
+// The arrival is when the event got out of OpenCV, time it waited in the
+// window system before is not included.
+void inputShown();
+
+#endif // INPUTQUEUE_H
@@ -0,0 +1,243 @@
+#include "InputReplay.h"
+
+#include <opencv2/highgui/highgui.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define CVUI_DISABLE_COMPILATION_NOTICES
+#include "cvui.h"
+#include "InputQueue.h"
+
+using namespace std;
+
+// One line of a recording, "poll;ms;key;code" or "poll;ms;mouse;event;x;y;flags".
+struct InputEvent {
+	uint64_t poll;
+	int64_t ms;
+	bool isKey;
+	int code;
+	int x;
+	int y;
+	int flags;
+};
+
+enum InputMode {
+	INPUT_LIVE,
+	INPUT_RECORD,
+	INPUT_REPLAY
+};
+
+static InputMode mode = INPUT_LIVE;
+static string path;
+// Every mouse event goes to this window, looked up once.
+static cvui::WindowHandle window;
+static ofstream recording;
+static string replayVideo;
+static vector<InputEvent> events;
+static size_t nextEvent = 0;
+static int64_t recordedMs = 0;
+static uint64_t recordedPolls = 0;
+static uint64_t polls = 0;
+static bool finished = false;
+static chrono::steady_clock::time_point started;
+
+static int64_t elapsedMs()
+{
+	return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+}
+
+static void finishRecording()
+{
+	recording << "end;" << polls << ";" << elapsedMs() << "\n";
+	recording.close();
+}
+
+// Replaces the callback of cvui to timestamp and record mouse events.
+static void onMouse(int event, int x, int y, int flags, void* data)
+{
+	inputMouseArrived();
+	if (mode == INPUT_RECORD) {
+		recording << polls << ";" << elapsedMs() << ";mouse;" << event << ";" << x << ";" << y << ";" << flags << "\n";
+	}
+	cvui::injectMouse(window, event, x, y, flags);
+}
+
+static bool readRecording()
+{
+	ifstream in(path.c_str());
+	if (!in.is_open()) {
+		return false;
+	}
+	string line;
+	while (getline(in, line)) {
+		// The path may contain anything but a line break.
+		if (line.compare(0, 6, "video;") == 0) {
+			replayVideo = line.substr(6);
+			continue;
+		}
+		istringstream fields(line);
+		vector<string> field;
+		string value;
+		while (getline(fields, value, ';')) {
+			field.push_back(value);
+		}
+		if (field.size() == 3 && field[0] == "end") {
+			recordedPolls = strtoull(field[1].c_str(), NULL, 10);
+			recordedMs = strtoll(field[2].c_str(), NULL, 10);
+		}
+		else if (field.size() >= 4) {
+			InputEvent e;
+			e.poll = strtoull(field[0].c_str(), NULL, 10);
+			e.ms = strtoll(field[1].c_str(), NULL, 10);
+			e.isKey = field[2] == "key";
+			e.code = (int)strtol(field[3].c_str(), NULL, 10);
+			e.x = e.y = e.flags = 0;
+			if (!e.isKey) {
+				if (field.size() != 7) {
+					return false;
+				}
+				e.x = (int)strtol(field[4].c_str(), NULL, 10);
+				e.y = (int)strtol(field[5].c_str(), NULL, 10);
+				e.flags = (int)strtol(field[6].c_str(), NULL, 10);
+			}
+			events.push_back(e);
+		}
+	}
+	return !replayVideo.empty();
+}
+
+bool inputFromArgs(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--record", 8) == 0 && (argv[i][8] == '\0' || argv[i][8] == '=')) {
+			mode = INPUT_RECORD;
+			path = argv[i][8] == '=' ? argv[i] + 9 : "input.rec";
+		}
+		else if (strncmp(argv[i], "--replay", 8) == 0 && (argv[i][8] == '\0' || argv[i][8] == '=')) {
+			mode = INPUT_REPLAY;
+			path = argv[i][8] == '=' ? argv[i] + 9 : "input.rec";
+		}
+	}
+	started = chrono::steady_clock::now();
+	if (mode == INPUT_REPLAY && !readRecording()) {
+		cerr << "Error reading recording " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+bool inputReplaying()
+{
+	return mode == INPUT_REPLAY;
+}
+
+const char* inputReplayVideo()
+{
+	return mode == INPUT_REPLAY ? replayVideo.c_str() : NULL;
+}
+
+void inputRecordVideo(const char* video)
+{
+	if (mode != INPUT_RECORD) {
+		return;
+	}
+	recording.open(path.c_str(), ios::out | ios::trunc);
+	if (!recording.is_open()) {
+		cerr << "Error opening " << path << " for recording" << endl;
+		mode = INPUT_LIVE;
+		return;
+	}
+	recording << "video;" << video << "\n";
+	atexit(finishRecording);
+}
+
+void inputRecordConfig(const MarkerConfig* config)
+{
+	if (mode != INPUT_RECORD) {
+		return;
+	}
+	string configPath = path + ".markers.bin";
+	if (config == NULL) {
+		// A file of an older recording would be replayed as its start.
+		remove(configPath.c_str());
+	}
+	else if (!writeBinary(configPath.c_str(), *config)) {
+		cerr << "Error writing " << configPath << endl;
+	}
+}
+
+bool inputReplayConfig(MarkerConfig& config)
+{
+	return mode == INPUT_REPLAY && readBinary((path + ".markers.bin").c_str(), config);
+}
+
+string inputConfigBase()
+{
+	return mode == INPUT_REPLAY ? path + ".replay" : "markers";
+}
+
+void inputInit(const cv::String& windowName)
+{
+	if (mode == INPUT_REPLAY) {
+		cvui::initHeadless(windowName);
+		window = cvui::handle(windowName);
+		return;
+	}
+	cvui::init(windowName);
+	window = cvui::handle(windowName);
+	cv::setMouseCallback(windowName, onMouse);
+}
+
+void inputShow(const cv::String& windowName, const cv::Mat& image)
+{
+	if (mode != INPUT_REPLAY) {
+		cv::imshow(windowName, image);
+	}
+}
+
+int inputWaitKey(int delay)
+{
+	if (mode != INPUT_REPLAY) {
+		int key = cv::waitKey(delay);
+		if (mode == INPUT_RECORD && key != -1) {
+			recording << polls << ";" << elapsedMs() << ";key;" << key << "\n";
+		}
+		polls++;
+		return key;
+	}
+
+	if (nextEvent == events.size() && polls >= recordedPolls) {
+		if (!finished) {
+			cout << "Replayed " << polls << " polls in " << elapsedMs() << " ms, recorded in " << recordedMs << " ms" << endl;
+			finished = true;
+		}
+		return -1;
+	}
+	int key = -1;
+	while (nextEvent < events.size() && events[nextEvent].poll == polls) {
+		const InputEvent& e = events[nextEvent++];
+		if (e.isKey) {
+			key = e.code;
+		}
+		else {
+			inputMouseArrived();
+			cvui::injectMouse(window, e.code, e.x, e.y, e.flags);
+		}
+	}
+	cvui::injectKey(key);
+	polls++;
+	return key;
+}
+
+bool inputFinished()
+{
+	return finished;
+}
@@ -0,0 +1,50 @@
+#ifndef INPUTREPLAY_H
+#define INPUTREPLAY_H
+
+#include <opencv2/core/core.hpp>
+#include <string>
+
+#include "MarkerConfig.h"
+
+// Recording and replay of the mouse events and keys of the configurator
+// window, so UI runs can be repeated and compared between builds.
+// Events are stored with the number of the inputWaitKey() call they arrived
+// in, the poll, and the milliseconds since the start. A replay hands every
+// event to cvui in the same poll as recorded, so the loops in main() see
+// the same input in the same frames. A replay does not wait and draws
+// offscreen only, no window is opened.
+
+// --record[=file] records while the configurator is used, --replay[=file]
+// replays a recording. The default file is input.rec.
+// Returns false if the recording to replay could not be read.
+bool inputFromArgs(int argc, char** argv);
+bool inputReplaying();
+
+// Video of the recording while replaying, otherwise NULL.
+const char* inputReplayVideo();
+// Stores the video in the recording, call before inputInit().
+void inputRecordVideo(const char* path);
+
+// The configuration the configurator started with is stored next to the
+// recording as <recording>.markers.bin, or NULL if there was none.
+void inputRecordConfig(const MarkerConfig* config);
+// Reads the configuration stored with the recording, false if there is none.
+// A replay starts from it instead of the files in the working directory.
+bool inputReplayConfig(MarkerConfig& config);
+// Base path for saving the configuration. A replay saves to
+// <recording>.replay.*, so it never overwrites the real markers files.
+std::string inputConfigBase();
+
+// Instead of cvui::init(), hooks the recording into the mouse callback of
+// cvui or sets cvui up headless for a replay.
+void inputInit(const cv::String& windowName);
+// Instead of cv::imshow(), does nothing while replaying.
+void inputShow(const cv::String& windowName, const cv::Mat& image);
+// Instead of cv::waitKey(), returns the recorded key while replaying.
+// Returns -1 once the replay is finished.
+int inputWaitKey(int delay);
+// True once a replay has handed out every recorded poll. The loops in
+// main() end then, so the background threads are stopped normally.
+bool inputFinished();
+
+#endif // INPUTREPLAY_H
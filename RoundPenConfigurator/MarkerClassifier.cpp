@@ -0,0 +1,179 @@
+#include "MarkerClassifier.h"
+
+#include <algorithm>
+
+// Kernel for exactly N markers. The loop over the models is unrolled at
+// compile time and every model is a simple pass over the chunk that the
+// compiler can vectorize, with the running minimum kept per pixel.
+template <int N>
+static void classifyChunk(const ClassifierTables& t, const int32_t* h, const int32_t* s, const int32_t* v, uchar* labels, int n)
+{
+	int32_t best[classifierChunk];
+	int32_t label[classifierChunk];
+	const int32_t hw = t.hueWeight, sw = t.satWeight, vw = t.valWeight;
+	for (int x = 0; x < n; x++) {
+		best[x] = t.maxDistance;
+		label[x] = 0;
+	}
+	for (int i = 0; i <= N; i++) {
+		const int32_t mh = t.hue[i], ms = t.sat[i], mv = t.val[i];
+		for (int x = 0; x < n; x++) {
+			int32_t dh = h[x] - mh;
+			dh = dh < 0 ? -dh : dh;
+			dh = dh > 90 ? 180 - dh : dh;
+			int32_t ds = s[x] - ms;
+			int32_t dv = v[x] - mv;
+			int32_t d = hw * dh * dh + sw * ds * ds + vw * dv * dv;
+			label[x] = d < best[x] ? i : label[x];
+			best[x] = d < best[x] ? d : best[x];
+		}
+	}
+	for (int x = 0; x < n; x++) {
+		labels[x] = (uchar)label[x];
+	}
+}
+
+// Kernel for any number of markers.
+static void classifyChunkGeneric(const ClassifierTables& t, const int32_t* h, const int32_t* s, const int32_t* v, uchar* labels, int n)
+{
+	const int models = t.markers + 1;
+	for (int x = 0; x < n; x++) {
+		int32_t best = t.maxDistance;
+		int32_t label = 0;
+		for (int i = 0; i < models; i++) {
+			int32_t d = hsvDistance(h[x], s[x], v[x], t.hue[i], t.sat[i], t.val[i], t);
+			if (d < best) {
+				best = d;
+				label = i;
+			}
+		}
+		labels[x] = (uchar)label;
+	}
+}
+
+// Indexed by the number of markers.
+static const ClassifyChunkFn specializedKernels[maxSpecializedMarkers + 1] = {
+	classifyChunk<0>, classifyChunk<1>, classifyChunk<2>, classifyChunk<3>,
+	classifyChunk<4>, classifyChunk<5>, classifyChunk<6>, classifyChunk<7>,
+	classifyChunk<8>, classifyChunk<9>, classifyChunk<10>, classifyChunk<11>,
+	classifyChunk<12>, classifyChunk<13>, classifyChunk<14>, classifyChunk<15>,
+	classifyChunk<16>
+};
+
+MarkerClassifier::MarkerClassifier()
+{
+	tables.markers = 0;
+	tables.hue.assign(1, 0);
+	tables.sat.assign(1, 0);
+	tables.val.assign(1, 0);
+	tables.hueWeight = defaultHueWeight;
+	tables.satWeight = defaultSatWeight;
+	tables.valWeight = defaultValWeight;
+	tables.maxDistance = defaultMaxDistance;
+	isa = CLASSIFIER_SCALAR;
+	if (!setIsa(CLASSIFIER_AVX2) && !setIsa(CLASSIFIER_SSE2)) {
+		selectKernel();
+	}
+}
+
+void MarkerClassifier::setColors(const cv::Vec3b& background, const cv::Vec3b* markers, int count)
+{
+	// Labels are stored as bytes.
+	CV_Assert(count >= 0 && count < 256);
+	tables.markers = count;
+	tables.hue.resize(count + 1);
+	tables.sat.resize(count + 1);
+	tables.val.resize(count + 1);
+	tables.hue[0] = background[0];
+	tables.sat[0] = background[1];
+	tables.val[0] = background[2];
+	for (int i = 0; i < count; i++) {
+		tables.hue[i + 1] = markers[i][0];
+		tables.sat[i + 1] = markers[i][1];
+		tables.val[i + 1] = markers[i][2];
+	}
+	selectKernel();
+}
+
+void MarkerClassifier::setWeights(int hue, int sat, int val)
+{
+	CV_Assert(hue >= 0 && hue <= 128 && sat >= 0 && sat <= 128 && val >= 0 && val <= 128);
+	tables.hueWeight = hue;
+	tables.satWeight = sat;
+	tables.valWeight = val;
+}
+
+void MarkerClassifier::setMaxDistance(int distance)
+{
+	tables.maxDistance = distance;
+}
+
+bool MarkerClassifier::isaSupported(ClassifierIsa isa)
+{
+	switch (isa) {
+	case CLASSIFIER_SSE2:
+		return sse2Kernel(0) != 0 && cv::checkHardwareSupport(CV_CPU_SSE2);
+	case CLASSIFIER_AVX2:
+		return avx2Kernel(0) != 0 && cv::checkHardwareSupport(CV_CPU_AVX2);
+	default:
+		return true;
+	}
+}
+
+bool MarkerClassifier::setIsa(ClassifierIsa isa)
+{
+	if (!isaSupported(isa)) {
+		return false;
+	}
+	this->isa = isa;
+	selectKernel();
+	return true;
+}
+
+void MarkerClassifier::selectKernel()
+{
+	int count = tables.markers;
+	switch (isa) {
+	case CLASSIFIER_AVX2:
+		kernel = avx2Kernel(count);
+		break;
+	case CLASSIFIER_SSE2:
+		kernel = sse2Kernel(count);
+		break;
+	default:
+		kernel = count <= maxSpecializedMarkers ? specializedKernels[count] : classifyChunkGeneric;
+		break;
+	}
+}
+
+void MarkerClassifier::classify(const cv::Mat& hsv, cv::Mat& labels) const
+{
+	run(hsv, labels, kernel);
+}
+
+void MarkerClassifier::classifyGeneric(const cv::Mat& hsv, cv::Mat& labels) const
+{
+	run(hsv, labels, classifyChunkGeneric);
+}
+
+void MarkerClassifier::run(const cv::Mat& hsv, cv::Mat& labels, ClassifyChunkFn fn) const
+{
+	CV_Assert(hsv.type() == CV_8UC3);
+	labels.create(hsv.rows, hsv.cols, CV_8UC1);
+
+	int32_t h[classifierChunk], s[classifierChunk], v[classifierChunk];
+	for (int y = 0; y < hsv.rows; y++) {
+		const uchar* src = hsv.ptr<uchar>(y);
+		uchar* dst = labels.ptr<uchar>(y);
+		for (int x0 = 0; x0 < hsv.cols; x0 += classifierChunk) {
+			int n = std::min(classifierChunk, hsv.cols - x0);
+			const uchar* p = src + 3 * x0;
+			for (int x = 0; x < n; x++) {
+				h[x] = p[3 * x];
+				s[x] = p[3 * x + 1];
+				v[x] = p[3 * x + 2];
+			}
+			fn(tables, h, s, v, dst + x0, n);
+		}
+	}
+}
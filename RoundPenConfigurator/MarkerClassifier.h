@@ -0,0 +1,100 @@
+#ifndef MARKERCLASSIFIER_H
+#define MARKERCLASSIFIER_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <vector>
+
+// Marker counts the classification kernels are specialised for.
+// Configurations with more markers fall back to the generic kernel.
+const int maxSpecializedMarkers = 16;
+
+// Pixels are classified in chunks of this many, split into H, S and V planes.
+const int classifierChunk = 256;
+
+// Distance weights and maximum distance of a new classifier.
+const int32_t defaultHueWeight = 4;
+const int32_t defaultSatWeight = 1;
+const int32_t defaultValWeight = 1;
+const int32_t defaultMaxDistance = 8000;
+
+// Colour models read by the classification kernels, one entry per model.
+// Entry 0 is the background, entry i (1..markers) the marker with label i.
+struct ClassifierTables {
+	int markers;
+	std::vector<int32_t> hue;
+	std::vector<int32_t> sat;
+	std::vector<int32_t> val;
+	int32_t hueWeight;
+	int32_t satWeight;
+	int32_t valWeight;
+	// Pixels further away than this from every model get label 0.
+	int32_t maxDistance;
+};
+
+// Weighted squared distance between two HSV colours in OpenCV's 8-bit range.
+// Hue is 0..179 and wraps around, so 2 and 177 are 5 apart.
+inline int32_t hsvDistance(int32_t h1, int32_t s1, int32_t v1, int32_t h2, int32_t s2, int32_t v2, const ClassifierTables& t)
+{
+	int32_t dh = h1 - h2;
+	dh = dh < 0 ? -dh : dh;
+	dh = dh > 90 ? 180 - dh : dh;
+	int32_t ds = s1 - s2;
+	int32_t dv = v1 - v2;
+	return t.hueWeight * dh * dh + t.satWeight * ds * ds + t.valWeight * dv * dv;
+}
+
+// Labels n pixels given as separate H, S and V planes.
+typedef void (*ClassifyChunkFn)(const ClassifierTables& t, const int32_t* h, const int32_t* s, const int32_t* v, uchar* labels, int n);
+
+// Instruction sets the kernels are available for.
+enum ClassifierIsa {
+	CLASSIFIER_SCALAR,
+	CLASSIFIER_SSE2,
+	CLASSIFIER_AVX2
+};
+
+// SIMD kernels from MarkerClassifierSimd.cpp for the given marker count.
+// Return null if the kernel was not compiled for this target.
+ClassifyChunkFn sse2Kernel(int markers);
+ClassifyChunkFn avx2Kernel(int markers);
+
+// Assigns every pixel to the nearest marker colour.
+// The kernel is picked once per configuration from a table of versions
+// specialised for 1..maxSpecializedMarkers markers, so the loop over the
+// markers is unrolled at compile time. By default the widest instruction
+// set supported by the CPU is used.
+class MarkerClassifier {
+public:
+	MarkerClassifier();
+
+	// Markers are labelled 1..count in the given order.
+	void setColors(const cv::Vec3b& background, const cv::Vec3b* markers, int count);
+	// Weights must be in 0..128 so the SIMD kernels can use 16-bit products.
+	void setWeights(int hue, int sat, int val);
+	void setMaxDistance(int distance);
+
+	// Labels a CV_8UC3 HSV image into a CV_8UC1 image:
+	// 0 for background or unknown, i for the i-th marker.
+	void classify(const cv::Mat& hsv, cv::Mat& labels) const;
+	// Same result as classify(), always using the generic scalar kernel.
+	void classifyGeneric(const cv::Mat& hsv, cv::Mat& labels) const;
+
+	// Returns false and keeps the current kernels if the CPU lacks the isa.
+	bool setIsa(ClassifierIsa isa);
+	ClassifierIsa getIsa() const { return isa; }
+	static bool isaSupported(ClassifierIsa isa);
+
+	int markers() const { return tables.markers; }
+	const ClassifierTables& getTables() const { return tables; }
+
+private:
+	void selectKernel();
+	void run(const cv::Mat& hsv, cv::Mat& labels, ClassifyChunkFn fn) const;
+
+	ClassifierTables tables;
+	ClassifierIsa isa;
+	ClassifyChunkFn kernel;
+};
+
+#endif // MARKERCLASSIFIER_H
@@ -0,0 +1,188 @@
+#include "MarkerClassifier.h"
+
+#include <string.h>
+
+// SIMD versions of the classification kernels.
+// Every lane holds one pixel as 32-bit integer. The weighted squares are
+// computed with madd_epi16 on lanes that hold small non negative values:
+// hue distance and weighted hue distance in the low 16 bits, saturation
+// distance and weighted saturation distance in the high 16 bits. This needs
+// weight * 255 to fit into 16 bits, see MarkerClassifier::setWeights().
+// As in the scalar kernels, N is the number of markers and N < 0 reads the
+// count from the tables.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CLASSIFIER_HAVE_SSE2 1
+	#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define CLASSIFIER_HAVE_AVX2 1
+	#include <immintrin.h>
+	#if defined(__GNUC__)
+		#define CLASSIFIER_AVX2_TARGET __attribute__((target("avx2")))
+	#else
+		#define CLASSIFIER_AVX2_TARGET
+	#endif
+#endif
+
+// Remaining pixels of a chunk that do not fill a whole vector.
+static inline void classifyTail(const ClassifierTables& t, const int32_t* h, const int32_t* s, const int32_t* v, uchar* labels, int n)
+{
+	const int models = t.markers + 1;
+	for (int x = 0; x < n; x++) {
+		int32_t best = t.maxDistance;
+		int32_t label = 0;
+		for (int i = 0; i < models; i++) {
+			int32_t d = hsvDistance(h[x], s[x], v[x], t.hue[i], t.sat[i], t.val[i], t);
+			if (d < best) {
+				best = d;
+				label = i;
+			}
+		}
+		labels[x] = (uchar)label;
+	}
+}
+
+#ifdef CLASSIFIER_HAVE_SSE2
+
+static inline __m128i absDiffSse2(__m128i a, __m128i b)
+{
+	__m128i d = _mm_sub_epi32(a, b);
+	__m128i sign = _mm_srai_epi32(d, 31);
+	return _mm_sub_epi32(_mm_xor_si128(d, sign), sign);
+}
+
+// Picks a where mask is set and b elsewhere.
+static inline __m128i selectSse2(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template <int N>
+static void classifyChunkSse2(const ClassifierTables& t, const int32_t* h, const int32_t* s, const int32_t* v, uchar* labels, int n)
+{
+	const int models = (N >= 0 ? N : t.markers) + 1;
+	const int32_t* mh = &t.hue[0];
+	const int32_t* ms = &t.sat[0];
+	const int32_t* mv = &t.val[0];
+	const __m128i c90 = _mm_set1_epi32(90);
+	const __m128i c180 = _mm_set1_epi32(180);
+	const __m128i weightHs = _mm_set1_epi32((t.satWeight << 16) | t.hueWeight);
+	const __m128i weightV = _mm_set1_epi32(t.valWeight);
+	const __m128i maxDistance = _mm_set1_epi32(t.maxDistance);
+
+	int x = 0;
+	for (; x + 4 <= n; x += 4) {
+		__m128i ph = _mm_loadu_si128((const __m128i*)(h + x));
+		__m128i ps = _mm_loadu_si128((const __m128i*)(s + x));
+		__m128i pv = _mm_loadu_si128((const __m128i*)(v + x));
+		__m128i best = maxDistance;
+		__m128i label = _mm_setzero_si128();
+		for (int i = 0; i < models; i++) {
+			__m128i dh = absDiffSse2(ph, _mm_set1_epi32(mh[i]));
+			dh = selectSse2(_mm_cmpgt_epi32(dh, c90), _mm_sub_epi32(c180, dh), dh);
+			__m128i ds = absDiffSse2(ps, _mm_set1_epi32(ms[i]));
+			__m128i dv = absDiffSse2(pv, _mm_set1_epi32(mv[i]));
+			__m128i hs = _mm_or_si128(dh, _mm_slli_epi32(ds, 16));
+			__m128i d = _mm_add_epi32(_mm_madd_epi16(hs, _mm_mullo_epi16(hs, weightHs)),
+				_mm_madd_epi16(dv, _mm_mullo_epi16(dv, weightV)));
+			__m128i closer = _mm_cmpgt_epi32(best, d);
+			best = selectSse2(closer, d, best);
+			label = selectSse2(closer, _mm_set1_epi32(i), label);
+		}
+		__m128i packed = _mm_packs_epi32(label, label);
+		packed = _mm_packus_epi16(packed, packed);
+		int32_t bytes = _mm_cvtsi128_si32(packed);
+		memcpy(labels + x, &bytes, 4);
+	}
+	classifyTail(t, h + x, s + x, v + x, labels + x, n - x);
+}
+
+static const ClassifyChunkFn sse2Kernels[maxSpecializedMarkers + 1] = {
+	classifyChunkSse2<0>, classifyChunkSse2<1>, classifyChunkSse2<2>, classifyChunkSse2<3>,
+	classifyChunkSse2<4>, classifyChunkSse2<5>, classifyChunkSse2<6>, classifyChunkSse2<7>,
+	classifyChunkSse2<8>, classifyChunkSse2<9>, classifyChunkSse2<10>, classifyChunkSse2<11>,
+	classifyChunkSse2<12>, classifyChunkSse2<13>, classifyChunkSse2<14>, classifyChunkSse2<15>,
+	classifyChunkSse2<16>
+};
+
+ClassifyChunkFn sse2Kernel(int markers)
+{
+	return markers <= maxSpecializedMarkers ? sse2Kernels[markers] : classifyChunkSse2<-1>;
+}
+
+#else
+
+ClassifyChunkFn sse2Kernel(int markers)
+{
+	return 0;
+}
+
+#endif // CLASSIFIER_HAVE_SSE2
+
+#ifdef CLASSIFIER_HAVE_AVX2
+
+template <int N>
+CLASSIFIER_AVX2_TARGET static void classifyChunkAvx2(const ClassifierTables& t, const int32_t* h, const int32_t* s, const int32_t* v, uchar* labels, int n)
+{
+	const int models = (N >= 0 ? N : t.markers) + 1;
+	const int32_t* mh = &t.hue[0];
+	const int32_t* ms = &t.sat[0];
+	const int32_t* mv = &t.val[0];
+	const __m256i c180 = _mm256_set1_epi32(180);
+	const __m256i weightHs = _mm256_set1_epi32((t.satWeight << 16) | t.hueWeight);
+	const __m256i weightV = _mm256_set1_epi32(t.valWeight);
+	const __m256i maxDistance = _mm256_set1_epi32(t.maxDistance);
+
+	int x = 0;
+	for (; x + 8 <= n; x += 8) {
+		__m256i ph = _mm256_loadu_si256((const __m256i*)(h + x));
+		__m256i ps = _mm256_loadu_si256((const __m256i*)(s + x));
+		__m256i pv = _mm256_loadu_si256((const __m256i*)(v + x));
+		__m256i best = maxDistance;
+		__m256i label = _mm256_setzero_si256();
+		for (int i = 0; i < models; i++) {
+			__m256i dh = _mm256_abs_epi32(_mm256_sub_epi32(ph, _mm256_set1_epi32(mh[i])));
+			dh = _mm256_min_epi32(dh, _mm256_sub_epi32(c180, dh));
+			__m256i ds = _mm256_abs_epi32(_mm256_sub_epi32(ps, _mm256_set1_epi32(ms[i])));
+			__m256i dv = _mm256_abs_epi32(_mm256_sub_epi32(pv, _mm256_set1_epi32(mv[i])));
+			__m256i hs = _mm256_or_si256(dh, _mm256_slli_epi32(ds, 16));
+			__m256i d = _mm256_add_epi32(_mm256_madd_epi16(hs, _mm256_mullo_epi16(hs, weightHs)),
+				_mm256_madd_epi16(dv, _mm256_mullo_epi16(dv, weightV)));
+			__m256i closer = _mm256_cmpgt_epi32(best, d);
+			best = _mm256_min_epi32(best, d);
+			label = _mm256_blendv_epi8(label, _mm256_set1_epi32(i), closer);
+		}
+		// Packing works per 128-bit half, so pixels 0..3 end up in the low
+		// half and pixels 4..7 in the high half.
+		__m256i packed = _mm256_packs_epi32(label, label);
+		packed = _mm256_packus_epi16(packed, packed);
+		int32_t low = _mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+		int32_t high = _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+		memcpy(labels + x, &low, 4);
+		memcpy(labels + x + 4, &high, 4);
+	}
+	classifyTail(t, h + x, s + x, v + x, labels + x, n - x);
+}
+
+static const ClassifyChunkFn avx2Kernels[maxSpecializedMarkers + 1] = {
+	classifyChunkAvx2<0>, classifyChunkAvx2<1>, classifyChunkAvx2<2>, classifyChunkAvx2<3>,
+	classifyChunkAvx2<4>, classifyChunkAvx2<5>, classifyChunkAvx2<6>, classifyChunkAvx2<7>,
+	classifyChunkAvx2<8>, classifyChunkAvx2<9>, classifyChunkAvx2<10>, classifyChunkAvx2<11>,
+	classifyChunkAvx2<12>, classifyChunkAvx2<13>, classifyChunkAvx2<14>, classifyChunkAvx2<15>,
+	classifyChunkAvx2<16>
+};
+
+ClassifyChunkFn avx2Kernel(int markers)
+{
+	return markers <= maxSpecializedMarkers ? avx2Kernels[markers] : classifyChunkAvx2<-1>;
+}
+
+#else
+
+ClassifyChunkFn avx2Kernel(int markers)
+{
+	return 0;
+}
+
+#endif // CLASSIFIER_HAVE_AVX2
@@ -0,0 +1,437 @@
+#include "MarkerConfig.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+using namespace std;
+
+static size_t align8(size_t value)
+{
+	return (value + 7) & ~(size_t)7;
+}
+
+// True if length bytes from offset end at or before end. Offsets come from
+// the file, so nothing is added to them that could wrap around.
+static bool sectionFits(uint64_t offset, uint64_t length, uint64_t end)
+{
+	return offset <= end && end - offset >= length;
+}
+
+MarkerConfig::MarkerConfig() : roi(0, 0, 0, 0), hueWeight(defaultHueWeight), satWeight(defaultSatWeight), valWeight(defaultValWeight),
+	maxDistance(defaultMaxDistance), minProbability(defaultMinProbability), minValue(defaultMinValue)
+{
+}
+
+void MarkerConfig::applyTo(MarkerClassifier& classifier) const
+{
+	classifier.setWeights(hueWeight, satWeight, valWeight);
+	classifier.setMaxDistance(maxDistance);
+	classifier.setColors(backgroundColor, colors.empty() ? NULL : &colors[0], (int)colors.size());
+}
+
+void MarkerConfig::applyTo(BackProjectionLut& lut) const
+{
+	lut.minProbability = minProbability;
+	lut.minValue = minValue;
+	lut.build(backgroundModel, models.empty() ? NULL : &models[0], (int)models.size());
+}
+
+std::string formatCsv(const MarkerConfig& config)
+{
+	ostringstream out;
+	out << "Background;" << static_cast<unsigned>(config.backgroundColor[0]) << ";" << static_cast<unsigned>(config.backgroundColor[1]) << ";" << static_cast<unsigned>(config.backgroundColor[2]) << "\n";
+	for (size_t i = 0; i < config.names.size(); i++) {
+		out << config.names[i] << ";" << static_cast<unsigned>(config.colors[i][0]) << ";" << static_cast<unsigned>(config.colors[i][1]) << ";" << static_cast<unsigned>(config.colors[i][2]) << "\n";
+	}
+	return out.str();
+}
+
+std::string formatHistograms(const MarkerConfig& config)
+{
+	// Same order as the CSV.
+	ostringstream out;
+	config.backgroundModel.write(out, "Background");
+	for (size_t i = 0; i < config.names.size(); i++) {
+		config.models[i].write(out, config.names[i]);
+	}
+	return out.str();
+}
+
+std::string formatBinary(const MarkerConfig& config)
+{
+	CV_Assert(config.colors.size() == config.names.size() && config.models.size() == config.names.size());
+	const uint32_t markers = (uint32_t)config.names.size();
+	const size_t binCount = histHueBins * histSatBins;
+
+	MarkerConfigHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = markerConfigMagic;
+	header.version = markerConfigVersion;
+	header.headerSize = sizeof(header);
+	header.markers = markers;
+	header.roiX = config.roi.x;
+	header.roiY = config.roi.y;
+	header.roiWidth = config.roi.width;
+	header.roiHeight = config.roi.height;
+	header.hueWeight = config.hueWeight;
+	header.satWeight = config.satWeight;
+	header.valWeight = config.valWeight;
+	header.maxDistance = config.maxDistance;
+	header.minProbability = config.minProbability;
+	header.minValue = config.minValue;
+	header.histHueBins = histHueBins;
+	header.histSatBins = histSatBins;
+
+	size_t namesSize = markers * sizeof(uint32_t);
+	for (uint32_t i = 0; i < markers; i++) {
+		namesSize += config.names[i].size() + 1;
+	}
+	header.namesOffset = align8(sizeof(header));
+	header.colorsOffset = align8(header.namesOffset + namesSize);
+	header.histogramsOffset = align8(header.colorsOffset + (markers + 1) * 4);
+	header.lutOffset = align8(header.histogramsOffset + (markers + 1) * (1 + binCount) * sizeof(uint32_t));
+	header.fileSize = header.lutOffset + 256 * 256;
+
+	string buffer((size_t)header.fileSize, '\0');
+	memcpy(&buffer[0], &header, sizeof(header));
+
+	uint32_t* nameOffsets = (uint32_t*)&buffer[header.namesOffset];
+	uint32_t nameOffset = markers * sizeof(uint32_t);
+	for (uint32_t i = 0; i < markers; i++) {
+		nameOffsets[i] = nameOffset;
+		memcpy(&buffer[header.namesOffset + nameOffset], config.names[i].c_str(), config.names[i].size() + 1);
+		nameOffset += (uint32_t)config.names[i].size() + 1;
+	}
+
+	uchar* colors = (uchar*)&buffer[header.colorsOffset];
+	uint32_t* histograms = (uint32_t*)&buffer[header.histogramsOffset];
+	for (uint32_t i = 0; i <= markers; i++) {
+		const cv::Vec3b& color = i == 0 ? config.backgroundColor : config.colors[i - 1];
+		const HistogramModel& model = i == 0 ? config.backgroundModel : config.models[i - 1];
+		colors[4 * i] = color[0];
+		colors[4 * i + 1] = color[1];
+		colors[4 * i + 2] = color[2];
+		uint32_t* histogram = histograms + i * (1 + binCount);
+		histogram[0] = model.samples;
+		memcpy(histogram + 1, &model.bins[0], binCount * sizeof(uint32_t));
+	}
+
+	BackProjectionLut lut;
+	config.applyTo(lut);
+	memcpy(&buffer[header.lutOffset], &lut.table[0], 256 * 256);
+	return buffer;
+}
+
+bool writeFileAtomic(const char* path, const std::string& content)
+{
+	string tmpPath = string(path) + ".tmp";
+	// The data has to be on disk before the rename, otherwise a crash
+	// could leave the new name pointing to an empty file.
+#ifdef _WIN32
+	HANDLE file = CreateFileA(tmpPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	DWORD written = 0;
+	bool ok = WriteFile(file, content.data(), (DWORD)content.size(), &written, NULL) && written == content.size();
+	ok = FlushFileBuffers(file) && ok;
+	CloseHandle(file);
+	// Fails while a reader still has the old file mapped.
+	ok = ok && MoveFileExA(tmpPath.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	bool ok = true;
+	for (size_t done = 0; ok && done < content.size();) {
+		ssize_t written = write(fd, content.data() + done, content.size() - done);
+		ok = written > 0;
+		done += ok ? (size_t)written : 0;
+	}
+	ok = fsync(fd) == 0 && ok;
+	ok = ::close(fd) == 0 && ok;
+	ok = ok && rename(tmpPath.c_str(), path) == 0;
+#endif
+	if (!ok) {
+		remove(tmpPath.c_str());
+	}
+	return ok;
+}
+
+bool writeCsv(const char* path, const MarkerConfig& config)
+{
+	return writeFileAtomic(path, formatCsv(config));
+}
+
+bool writeHistograms(const char* path, const MarkerConfig& config)
+{
+	return writeFileAtomic(path, formatHistograms(config));
+}
+
+bool writeBinary(const char* path, const MarkerConfig& config)
+{
+	return writeFileAtomic(path, formatBinary(config));
+}
+
+bool readCsv(const char* path, MarkerConfig& config)
+{
+	ifstream infile(path);
+	if (!infile.is_open()) {
+		return false;
+	}
+	vector<string> names;
+	vector<cv::Vec3b> colors;
+	cv::Vec3b backgroundColor;
+	bool backgroundFound = false;
+	string line;
+	while (getline(infile, line)) {
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		// The name may not contain ';', so the colour is after the first one.
+		size_t separator = line.find(';');
+		if (separator == string::npos) {
+			continue;
+		}
+		istringstream fields(line.substr(separator + 1));
+		unsigned h, s, v;
+		char sep1, sep2;
+		if (!(fields >> h >> sep1 >> s >> sep2 >> v) || sep1 != ';' || sep2 != ';' || h > 179 || s > 255 || v > 255) {
+			continue;
+		}
+		string name = line.substr(0, separator);
+		cv::Vec3b color((uchar)h, (uchar)s, (uchar)v);
+		if (!backgroundFound && name == "Background") {
+			backgroundColor = color;
+			backgroundFound = true;
+		}
+		else if (names.size() < 255) {
+			names.push_back(name);
+			colors.push_back(color);
+		}
+	}
+	if (!backgroundFound) {
+		return false;
+	}
+	config.names = names;
+	config.colors = colors;
+	config.models.assign(names.size(), HistogramModel());
+	config.backgroundColor = backgroundColor;
+	config.backgroundModel.clear();
+	return true;
+}
+
+bool readHistograms(const char* path, MarkerConfig& config)
+{
+	ifstream infile(path);
+	if (!infile.is_open()) {
+		return false;
+	}
+	string line;
+	bool backgroundFound = false;
+	while (getline(infile, line)) {
+		size_t separator = line.find(';');
+		if (separator == string::npos) {
+			continue;
+		}
+		string name = line.substr(0, separator);
+		HistogramModel* model = 0;
+		if (!backgroundFound && name == "Background") {
+			model = &config.backgroundModel;
+			backgroundFound = true;
+		}
+		else {
+			for (size_t i = 0; i < config.names.size() && model == 0; i++) {
+				if (config.names[i] == name && config.models[i].samples == 0) {
+					model = &config.models[i];
+				}
+			}
+		}
+		if (model != 0) {
+			model->read(line.substr(separator + 1));
+		}
+	}
+	return true;
+}
+
+bool readBinary(const char* path, MarkerConfig& config)
+{
+	MappedMarkerConfig mapped;
+	if (!mapped.open(path)) {
+		return false;
+	}
+	mapped.toConfig(config);
+	return true;
+}
+
+MappedMarkerConfig::MappedMarkerConfig() : data(0), size(0)
+{
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	fd = -1;
+#endif
+}
+
+MappedMarkerConfig::~MappedMarkerConfig()
+{
+	close();
+}
+
+bool MappedMarkerConfig::open(const char* path)
+{
+	close();
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MarkerConfigHeader)) {
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		close();
+		return false;
+	}
+	data = (const uchar*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)fileSize.QuadPart;
+#else
+	fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MarkerConfigHeader)) {
+		close();
+		return false;
+	}
+	void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	data = mapped == MAP_FAILED ? 0 : (const uchar*)mapped;
+	size = (size_t)st.st_size;
+#endif
+	if (data == 0) {
+		close();
+		return false;
+	}
+
+	const MarkerConfigHeader& h = header();
+	const size_t binCount = histHueBins * histSatBins;
+	bool valid = h.magic == markerConfigMagic && h.version == markerConfigVersion
+		&& h.headerSize >= sizeof(MarkerConfigHeader) && h.markers < 256
+		&& h.histHueBins == (uint32_t)histHueBins && h.histSatBins == (uint32_t)histSatBins
+		&& h.fileSize == size && h.headerSize <= size
+		// The sections follow the header in this order, the uint32 ones aligned.
+		&& h.namesOffset >= h.headerSize && h.namesOffset % 4 == 0 && h.histogramsOffset % 4 == 0
+		&& sectionFits(h.namesOffset, (uint64_t)h.markers * sizeof(uint32_t), h.colorsOffset)
+		&& sectionFits(h.colorsOffset, (uint64_t)(h.markers + 1) * 4, h.histogramsOffset)
+		&& sectionFits(h.histogramsOffset, (uint64_t)(h.markers + 1) * (1 + binCount) * sizeof(uint32_t), h.lutOffset)
+		&& sectionFits(h.lutOffset, 256 * 256, size)
+		// MarkerClassifier::setWeights() asserts this range, the SIMD kernels need it for 16-bit products.
+		&& h.hueWeight >= 0 && h.hueWeight <= 128 && h.satWeight >= 0 && h.satWeight <= 128 && h.valWeight >= 0 && h.valWeight <= 128
+		&& h.maxDistance >= 0 && h.minValue >= 0 && h.minValue <= 255;
+	// Hue is 0..179 as in readCsv(), the SIMD kernels rely on it for the wrap around.
+	for (uint32_t i = 0; valid && i <= h.markers; i++) {
+		valid = data[h.colorsOffset + 4 * i] <= 179;
+	}
+	// Every name has to end inside the names section.
+	for (uint32_t i = 0; valid && i < h.markers; i++) {
+		uint64_t namesSize = h.colorsOffset - h.namesOffset;
+		uint32_t offset = ((const uint32_t*)(data + h.namesOffset))[i];
+		valid = offset < namesSize && memchr(data + h.namesOffset + offset, 0, (size_t)(namesSize - offset)) != NULL;
+	}
+	if (!valid) {
+		close();
+	}
+	return valid;
+}
+
+void MappedMarkerConfig::close()
+{
+#ifdef _WIN32
+	if (data != 0) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping != NULL) {
+		CloseHandle(mapping);
+		mapping = NULL;
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data != 0) {
+		munmap((void*)data, size);
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+#endif
+	data = 0;
+	size = 0;
+}
+
+const char* MappedMarkerConfig::name(int marker) const
+{
+	const uint32_t* offsets = (const uint32_t*)(data + header().namesOffset);
+	return (const char*)(data + header().namesOffset + offsets[marker]);
+}
+
+cv::Vec3b MappedMarkerConfig::color(int model) const
+{
+	const uchar* c = data + header().colorsOffset + 4 * model;
+	return cv::Vec3b(c[0], c[1], c[2]);
+}
+
+const uint32_t* MappedMarkerConfig::histogram(int model) const
+{
+	return (const uint32_t*)(data + header().histogramsOffset) + model * (1 + histHueBins * histSatBins);
+}
+
+void MappedMarkerConfig::toConfig(MarkerConfig& config) const
+{
+	const MarkerConfigHeader& h = header();
+	const int count = markers();
+	config.names.resize(count);
+	config.colors.resize(count);
+	config.models.resize(count);
+	for (int i = 0; i <= count; i++) {
+		const uint32_t* histogram = this->histogram(i);
+		HistogramModel& model = i == 0 ? config.backgroundModel : config.models[i - 1];
+		model.samples = histogram[0];
+		model.bins.assign(histogram + 1, histogram + 1 + histHueBins * histSatBins);
+		if (i == 0) {
+			config.backgroundColor = color(0);
+		}
+		else {
+			config.names[i - 1] = name(i - 1);
+			config.colors[i - 1] = color(i);
+		}
+	}
+	config.roi = cv::Rect(h.roiX, h.roiY, h.roiWidth, h.roiHeight);
+	config.hueWeight = h.hueWeight;
+	config.satWeight = h.satWeight;
+	config.valWeight = h.valWeight;
+	config.maxDistance = h.maxDistance;
+	config.minProbability = h.minProbability;
+	config.minValue = h.minValue;
+}
@@ -0,0 +1,140 @@
+#ifndef MARKERCONFIG_H
+#define MARKERCONFIG_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "HistogramModel.h"
+#include "MarkerClassifier.h"
+
+// Everything the configurator produces for a tracker.
+// Saved as markers.csv and markers.hist for humans and as markers.bin,
+// which a tracker can map into memory and use without parsing.
+struct MarkerConfig {
+	// Starts with the default thresholds of MarkerClassifier and BackProjectionLut.
+	MarkerConfig();
+
+	std::vector<std::string> names;
+	std::vector<cv::Vec3b> colors;
+	std::vector<HistogramModel> models;
+	cv::Vec3b backgroundColor;
+	HistogramModel backgroundModel;
+
+	// Region of interest in full resolution video coordinates.
+	cv::Rect roi;
+
+	// MarkerClassifier thresholds.
+	int hueWeight;
+	int satWeight;
+	int valWeight;
+	int maxDistance;
+	// BackProjectionLut thresholds.
+	float minProbability;
+	int minValue;
+
+	void applyTo(MarkerClassifier& classifier) const;
+	void applyTo(BackProjectionLut& lut) const;
+};
+
+// File contents, built in memory so they can be written in one go.
+std::string formatCsv(const MarkerConfig& config);
+std::string formatHistograms(const MarkerConfig& config);
+// Also precomputes the back-projection table.
+std::string formatBinary(const MarkerConfig& config);
+
+// Writes to path.tmp and renames it to path, so a reader sees either the
+// old or the new file but never a partly written one.
+bool writeFileAtomic(const char* path, const std::string& content);
+
+bool writeCsv(const char* path, const MarkerConfig& config);
+bool writeHistograms(const char* path, const MarkerConfig& config);
+bool writeBinary(const char* path, const MarkerConfig& config);
+
+// Replace the markers of config with the ones in the file.
+// The CSV has no models, they are left empty until readHistograms().
+bool readCsv(const char* path, MarkerConfig& config);
+// Fills the models of markers already in config, matched by name.
+bool readHistograms(const char* path, MarkerConfig& config);
+bool readBinary(const char* path, MarkerConfig& config);
+
+// "RPMC" in little endian.
+const uint32_t markerConfigMagic = 0x434d5052;
+const uint32_t markerConfigVersion = 1;
+
+// Start of markers.bin. All numbers are little endian, all offsets count
+// from the start of the file and every section is 8 byte aligned.
+struct MarkerConfigHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t markers;
+
+	int32_t roiX;
+	int32_t roiY;
+	int32_t roiWidth;
+	int32_t roiHeight;
+
+	int32_t hueWeight;
+	int32_t satWeight;
+	int32_t valWeight;
+	int32_t maxDistance;
+	float minProbability;
+	int32_t minValue;
+
+	uint32_t histHueBins;
+	uint32_t histSatBins;
+
+	// markers uint32 offsets relative to this section, each pointing to a
+	// NUL terminated name that follows the offsets.
+	uint64_t namesOffset;
+	// markers + 1 entries of H, S, V and a padding byte, background first.
+	uint64_t colorsOffset;
+	// markers + 1 histograms, background first, each the sample count
+	// followed by histHueBins * histSatBins uint32 bins.
+	uint64_t histogramsOffset;
+	// 256 * 256 labels of BackProjectionLut::table.
+	uint64_t lutOffset;
+	uint64_t fileSize;
+};
+
+// Read only view of a markers.bin mapped into memory.
+class MappedMarkerConfig {
+public:
+	MappedMarkerConfig();
+	~MappedMarkerConfig();
+
+	// Maps the file and checks magic, version, section bounds, thresholds and colours.
+	bool open(const char* path);
+	void close();
+	bool isOpen() const { return data != 0; }
+
+	const MarkerConfigHeader& header() const { return *(const MarkerConfigHeader*)data; }
+	int markers() const { return (int)header().markers; }
+	const char* name(int marker) const;
+	// HSV of the model, 0 is the background and 1..markers the markers.
+	cv::Vec3b color(int model) const;
+	// Sample count followed by the bins of the model, indexed as color().
+	const uint32_t* histogram(int model) const;
+	// 256 * 256 labels indexed by hue * 256 + sat.
+	const uchar* lut() const { return data + header().lutOffset; }
+
+	// Copies the mapped content, e.g. to edit it.
+	void toConfig(MarkerConfig& config) const;
+
+private:
+	MappedMarkerConfig(const MappedMarkerConfig&);
+	MappedMarkerConfig& operator=(const MappedMarkerConfig&);
+
+	const uchar* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int fd;
+#endif
+};
+
+#endif // MARKERCONFIG_H
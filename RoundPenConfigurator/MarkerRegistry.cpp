@@ -0,0 +1,56 @@
+#include "MarkerRegistry.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+cv::Vec3b windowColor(const cv::Vec3b& hsv)
+{
+	cv::Mat pixel(1, 1, CV_8UC3, cv::Scalar(hsv[0], hsv[1], hsv[2]));
+	cv::cvtColor(pixel, pixel, cv::COLOR_HSV2BGR);
+	return pixel.at<cv::Vec3b>(0, 0);
+}
+
+int MarkerRegistry::add()
+{
+	CV_Assert(size() < maxMarkers);
+	names.push_back(std::string());
+	colors.push_back(cv::Vec3b());
+	windowColors.push_back(cv::Vec3b());
+	models.push_back(HistogramModel());
+	return size() - 1;
+}
+
+void MarkerRegistry::remove(int marker)
+{
+	CV_Assert(marker >= 0 && marker < size());
+	names.erase(names.begin() + marker);
+	colors.erase(colors.begin() + marker);
+	windowColors.erase(windowColors.begin() + marker);
+	models.erase(models.begin() + marker);
+}
+
+void MarkerRegistry::clear()
+{
+	names.clear();
+	colors.clear();
+	windowColors.clear();
+	models.clear();
+}
+
+void MarkerRegistry::exportTo(MarkerConfig& config, int count) const
+{
+	CV_Assert(count >= 0 && count <= size());
+	config.names.assign(names.begin(), names.begin() + count);
+	config.colors.assign(colors.begin(), colors.begin() + count);
+	config.models.assign(models.begin(), models.begin() + count);
+}
+
+void MarkerRegistry::importFrom(const MarkerConfig& config)
+{
+	names = config.names;
+	colors = config.colors;
+	models = config.models;
+	windowColors.resize(colors.size());
+	for (size_t i = 0; i < colors.size(); i++) {
+		windowColors[i] = windowColor(colors[i]);
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef MARKERREGISTRY_H
+#define MARKERREGISTRY_H
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "HistogramModel.h"
+#include "MarkerConfig.h"
+
+// Labels are stored as uchar and 0 is the background.
+const int maxMarkers = 255;
+
+// BGR colour to show for an HSV colour, for markers that were loaded
+// instead of picked in the window.
+cv::Vec3b windowColor(const cv::Vec3b& hsv);
+
+// All markers of a configuration session, one array per property so the
+// colours can be handed to the classifier as they are. Marker i is at index
+// i of every array.
+class MarkerRegistry {
+public:
+	int size() const { return (int)names.size(); }
+	bool empty() const { return names.empty(); }
+
+	// Appends a marker without name and colour and returns its index.
+	int add();
+	void remove(int marker);
+	void clear();
+
+	// Copies the first count markers into the marker part of config.
+	void exportTo(MarkerConfig& config, int count) const;
+	// Replaces all markers with the ones of config.
+	void importFrom(const MarkerConfig& config);
+
+	std::vector<std::string> names;
+	// HSV colour picked for the marker.
+	std::vector<cv::Vec3b> colors;
+	// BGR colour of the same pixel, to show the marker in the window.
+	std::vector<cv::Vec3b> windowColors;
+	std::vector<HistogramModel> models;
+};
+
+#endif // MARKERREGISTRY_H
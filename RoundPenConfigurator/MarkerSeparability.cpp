@@ -0,0 +1,115 @@
+#include "MarkerSeparability.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+#define CVUI_DISABLE_COMPILATION_NOTICES
+#include "cvui.h"
+
+const int cellWidth = 34;
+const int cellHeight = 15;
+
+MarkerSeparability::MarkerSeparability() : worst(0), worstRow(0), worstCol(0)
+{
+}
+
+void MarkerSeparability::update(const std::vector<uint64_t>& pixels, const HistogramModel& background, const HistogramModel* markers, int count)
+{
+	CV_Assert(pixels.size() == (size_t)(histHueBins * histSatBins));
+	BackProjectionLut lut;
+	lut.build(background, markers, count);
+
+	int models = count + 1;
+	std::vector<double> sums(models * models, 0);
+	std::vector<uchar> claims(models);
+	for (int hb = 0; hb < histHueBins; hb++) {
+		for (int sb = 0; sb < histSatBins; sb++) {
+			uint64_t n = pixels[hb * histSatBins + sb];
+			if (n == 0) {
+				continue;
+			}
+			// The colour at the start of the bin, as BackProjectionLut::build() decides per bin.
+			int hue = hb * 180 / histHueBins;
+			int sat = sb * 256 / histSatBins;
+			int label = lut.table[hue * 256 + sat];
+			for (int i = 0; i < models; i++) {
+				const HistogramModel& model = i == 0 ? background : markers[i - 1];
+				if (model.probability(hue, sat) >= lut.minProbability) {
+					sums[i * models + label] += (double)n;
+				}
+			}
+		}
+	}
+
+	confusion.create(models, models, CV_32FC1);
+	worst = 0;
+	worstRow = worstCol = 0;
+	for (int i = 0; i < models; i++) {
+		double rowSum = 0;
+		for (int j = 0; j < models; j++) {
+			rowSum += sums[i * models + j];
+		}
+		float* row = confusion.ptr<float>(i);
+		for (int j = 0; j < models; j++) {
+			row[j] = rowSum > 0 ? (float)(sums[i * models + j] / rowSum) : 0;
+			// Taken for the background a marker is only missed, taken for another marker it is a wrong detection.
+			if (j != i && j > 0 && row[j] > worst) {
+				worst = row[j];
+				worstRow = i;
+				worstCol = j;
+			}
+		}
+	}
+}
+
+int MarkerSeparability::width() const
+{
+	return (std::min(confusion.cols, maxSeparabilityRows) + 1) * cellWidth;
+}
+
+int MarkerSeparability::height() const
+{
+	return (std::min(confusion.rows, maxSeparabilityRows) + 1) * cellHeight;
+}
+
+void MarkerSeparability::describeWorst(char* text, size_t size) const
+{
+	if (worst <= 0) {
+		snprintf(text, size, "No colour is taken for a marker it does not belong to");
+	}
+	else if (worstRow == 0) {
+		snprintf(text, size, "Background looks like marker %d in %.0f%% of its pixels", worstCol - 1, worst * 100);
+	}
+	else {
+		snprintf(text, size, "Marker %d looks like marker %d in %.0f%% of its pixels", worstRow - 1, worstCol - 1, worst * 100);
+	}
+}
+
+void MarkerSeparability::draw(cv::Mat& where, int x, int y) const
+{
+	int n = std::min(confusion.rows, maxSeparabilityRows);
+	for (int i = 0; i < n; i++) {
+		// Background is B, markers are numbered from 0 like in the panel.
+		if (i == 0) {
+			cvui::text(where, x + cellWidth, y, "B", 0.4, 0xCECECE);
+			cvui::text(where, x, y + cellHeight, "B", 0.4, 0xCECECE);
+		}
+		else {
+			cvui::printf(where, x + (i + 1) * cellWidth, y, 0.4, 0xCECECE, "%d", i - 1);
+			cvui::printf(where, x, y + (i + 1) * cellHeight, 0.4, 0xCECECE, "%d", i - 1);
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		const float* row = confusion.ptr<float>(i);
+		for (int j = 0; j < n; j++) {
+			unsigned int color = 0xCECECE;
+			if (i != j && j > 0 && row[j] > maxMarkerConfusion) {
+				color = 0xff0000;
+			}
+			else if (i != j && row[j] >= 0.05f) {
+				color = 0xffa000;
+			}
+			cvui::printf(where, x + (j + 1) * cellWidth, y + (i + 1) * cellHeight, 0.4, color, "%.0f%%", row[j] * 100);
+		}
+	}
+}
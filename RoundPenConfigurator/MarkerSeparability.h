@@ -0,0 +1,46 @@
+#ifndef MARKERSEPARABILITY_H
+#define MARKERSEPARABILITY_H
+
+#include <opencv2/core/core.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "HistogramModel.h"
+
+// A marker taken for another one more often than this is warned about before saving.
+const float maxMarkerConfusion = 0.2f;
+// Rows and columns drawn at most, the background and 7 markers.
+const int maxSeparabilityRows = 8;
+
+// Confusion of the colour models over the colours of a video. A pixel
+// belongs to the row of every model that has at least the minimum
+// probability of BackProjectionLut for it, and to the column of the label
+// the lookup table gives it. Row and column 0 are the background, row i
+// the marker with label i. Each row is normalized to shares of its pixels,
+// so a large share off the diagonal means that colour is often taken for
+// another marker.
+class MarkerSeparability {
+public:
+	MarkerSeparability();
+
+	// pixels holds a count per H-S bin, e.g. from VideoColorStats::binTotals().
+	void update(const std::vector<uint64_t>& pixels, const HistogramModel& background, const HistogramModel* markers, int count);
+
+	// Draws the matrix with its top left corner at (x, y).
+	void draw(cv::Mat& where, int x, int y) const;
+	int width() const;
+	int height() const;
+	// The worst pair in words, for where the matrix does not fit.
+	void describeWorst(char* text, size_t size) const;
+
+	// (count + 1) x (count + 1) CV_32FC1.
+	cv::Mat confusion;
+	// Largest share off the diagonal with a marker column, 0 if none,
+	// and its row and column.
+	float worst;
+	int worstRow;
+	int worstCol;
+};
+
+#endif // MARKERSEPARABILITY_H
@@ -0,0 +1,174 @@
+#include "MotionRoi.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Trace.h"
+
+// Share of the motion left out at each side of the box.
+static const double motionTail = 0.01;
+// Margin around the box, as share of its size, markers reach out a bit further than the sampled positions.
+static const double motionMargin = 0.05;
+
+// Index where the running sum of values reaches share of their total.
+static int massIndex(const std::vector<double>& values, double total, double share)
+{
+	double sum = 0;
+	for (size_t i = 0; i < values.size(); i++) {
+		sum += values[i];
+		if (sum >= total * share) {
+			return (int)i;
+		}
+	}
+	return (int)values.size() - 1;
+}
+
+// Box of the pixels in the CV_32FC1 energy map that move clearly more than the average.
+static bool motionBox(const cv::Mat& energy, cv::Rect& box)
+{
+	double sum = 0;
+	double sumSq = 0;
+	for (int y = 0; y < energy.rows; y++) {
+		const float* e = energy.ptr<float>(y);
+		for (int x = 0; x < energy.cols; x++) {
+			sum += e[x];
+			sumSq += e[x] * (double)e[x];
+		}
+	}
+	double n = energy.rows * (double)energy.cols;
+	double mean = sum / n;
+	double threshold = mean + 2 * sqrt(std::max(0.0, sumSq / n - mean * mean));
+
+	// Motion above the threshold per column and row.
+	std::vector<double> columns(energy.cols, 0);
+	std::vector<double> rows(energy.rows, 0);
+	double total = 0;
+	for (int y = 0; y < energy.rows; y++) {
+		const float* e = energy.ptr<float>(y);
+		for (int x = 0; x < energy.cols; x++) {
+			if (e[x] > threshold) {
+				columns[x] += e[x];
+				rows[y] += e[x];
+				total += e[x];
+			}
+		}
+	}
+	if (total <= 0) {
+		return false;
+	}
+	int left = massIndex(columns, total, motionTail);
+	int right = massIndex(columns, total, 1 - motionTail);
+	int top = massIndex(rows, total, motionTail);
+	int bottom = massIndex(rows, total, 1 - motionTail);
+	int marginX = (int)ceil((right - left + 1) * motionMargin);
+	int marginY = (int)ceil((bottom - top + 1) * motionMargin);
+	box = cv::Rect(cv::Point(left - marginX, top - marginY), cv::Point(right + 1 + marginX, bottom + 1 + marginY));
+	box &= cv::Rect(0, 0, energy.cols, energy.rows);
+	return box.area() > 0;
+}
+
+MotionRoi::MotionRoi() : stopping(false), finished(false)
+{
+}
+
+MotionRoi::~MotionRoi()
+{
+	stop();
+}
+
+void MotionRoi::start(const std::string& path)
+{
+	stop();
+	proposal = cv::Rect();
+	stopping = false;
+	finished = false;
+	worker = std::thread(&MotionRoi::run, this, path);
+}
+
+void MotionRoi::stop()
+{
+	if (worker.joinable()) {
+		stopping = true;
+		worker.join();
+	}
+}
+
+bool MotionRoi::result(cv::Rect& roi) const
+{
+	if (!finished) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	roi = proposal;
+	return roi.area() > 0;
+}
+
+void MotionRoi::run(std::string path)
+{
+	traceThreadName("motion roi");
+	cv::VideoCapture cap(path);
+	double fps = cap.get(cv::CAP_PROP_FPS);
+	int step = std::max(1, fps >= 2 ? (int)(fps / 2) : 15);
+
+	// Decoding is sequential, only the comparison runs in parallel.
+	std::vector<cv::Mat> samples;
+	cv::Mat frame;
+	cv::Mat small;
+	cv::Size fullSize;
+	{
+		TRACE_SCOPE("motion sample");
+		for (int nr = 0; cap.isOpened() && !stopping && (int)samples.size() < maxMotionFrames; nr++) {
+			if (nr % step != 0) {
+				if (!cap.grab()) {
+					break;
+				}
+				continue;
+			}
+			if (!cap.read(frame)) {
+				break;
+			}
+			fullSize = frame.size();
+			cv::Size size(motionWidth, std::max(1, motionWidth * frame.rows / frame.cols));
+			cv::resize(frame, small, size, 0, 0, cv::INTER_AREA);
+			samples.push_back(cv::Mat());
+			cv::cvtColor(small, samples.back(), cv::COLOR_BGR2GRAY);
+		}
+	}
+	if (samples.size() < 2 || stopping) {
+		finished = true;
+		return;
+	}
+
+	TRACE_SCOPE("motion map");
+	cv::Mat energy = cv::Mat::zeros(samples[0].rows, samples[0].cols, CV_32FC1);
+	std::mutex energyMutex;
+	cv::parallel_for_(cv::Range(1, (int)samples.size()), [&](const cv::Range& range) {
+		cv::Mat sums = cv::Mat::zeros(energy.rows, energy.cols, CV_32FC1);
+		for (int i = range.start; i < range.end; i++) {
+			for (int y = 0; y < sums.rows; y++) {
+				const uchar* a = samples[i - 1].ptr<uchar>(y);
+				const uchar* b = samples[i].ptr<uchar>(y);
+				float* s = sums.ptr<float>(y);
+				for (int x = 0; x < sums.cols; x++) {
+					s[x] += (float)abs(a[x] - b[x]);
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(energyMutex);
+		energy += sums;
+	});
+
+	cv::Rect box;
+	if (motionBox(energy, box)) {
+		double scaleX = fullSize.width / (double)energy.cols;
+		double scaleY = fullSize.height / (double)energy.rows;
+		cv::Rect full(cv::Point((int)(box.x * scaleX), (int)(box.y * scaleY)), cv::Point((int)ceil(box.br().x * scaleX), (int)ceil(box.br().y * scaleY)));
+		std::lock_guard<std::mutex> lock(mutex);
+		proposal = full & cv::Rect(0, 0, fullSize.width, fullSize.height);
+	}
+	finished = true;
+}
@@ -0,0 +1,49 @@
+#ifndef MOTIONROI_H
+#define MOTIONROI_H
+
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Frames compared at most, two per second of video.
+const int maxMotionFrames = 200;
+// Width of the frames the motion is measured on.
+const int motionWidth = 160;
+
+// Proposes the region where the markers move, so the ROI does not have to
+// be dragged by hand. A background thread samples frames of the video at
+// motionWidth in grey, then the absolute differences of neighbouring
+// samples are summed per pixel in parallel. Pixels moving clearly more than
+// the rest of the frame make up the motion, its bounding box with a margin
+// is the proposal. Isolated spots at the edges are cut off by taking the
+// box of the middle 98% of the motion in both directions.
+class MotionRoi {
+public:
+	MotionRoi();
+	// Stops before returning.
+	~MotionRoi();
+
+	void start(const std::string& path);
+	void stop();
+
+	// True once the proposal is ready and something moved, with the region
+	// in full resolution pixels.
+	bool result(cv::Rect& roi) const;
+	bool done() const { return finished; }
+
+private:
+	MotionRoi(const MotionRoi&);
+	MotionRoi& operator=(const MotionRoi&);
+
+	void run(std::string path);
+
+	mutable std::mutex mutex;
+	cv::Rect proposal;
+	std::atomic<bool> stopping;
+	std::atomic<bool> finished;
+	std::thread worker;
+};
+
+#endif // MOTIONROI_H
@@ -0,0 +1,116 @@
+#include "PerfHud.h"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+#elif defined(__linux__)
+	#include <unistd.h>
+#endif
+
+#define CVUI_DISABLE_COMPILATION_NOTICES
+#include "cvui.h"
+#include "PooledMatAllocator.h"
+
+// Reading the resident memory is a system call, not needed every frame.
+const uint32_t residentEveryXFrames = 30;
+
+size_t processResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#elif defined(__linux__)
+	// Second field of statm is the resident size in pages.
+	std::ifstream statm("/proc/self/statm");
+	size_t pages = 0;
+	size_t resident = 0;
+	if (statm >> pages >> resident) {
+		return resident * (size_t)sysconf(_SC_PAGESIZE);
+	}
+	return 0;
+#else
+	return 0;
+#endif
+}
+
+PerfHud::PerfHud() : visible(false), lastAllocations(0), lastHeapAllocations(0), drawnFrames(0), residentBytes(0)
+{
+	frameRing = traceRing("frame");
+	decodeRing = traceRing("decode");
+	latencyRing = traceRing("input latency");
+}
+
+PerfHud::~PerfHud()
+{
+	setVisible(false);
+}
+
+void PerfHud::setVisible(bool visible)
+{
+	if (visible == this->visible) {
+		return;
+	}
+	this->visible = visible;
+	traceRingsEnable(visible);
+	if (visible) {
+		allocator.install();
+		lastAllocations = allocator.allocations();
+		lastHeapAllocations = PooledMatAllocator::instance().heapAllocations();
+		drawnFrames = 0;
+	}
+	else {
+		allocator.uninstall();
+	}
+}
+
+void PerfHud::draw(cv::Mat& where, int x, int y)
+{
+	if (!visible) {
+		return;
+	}
+	uint64_t allocations = allocator.allocations();
+	uint64_t frameAllocations = allocations - lastAllocations;
+	lastAllocations = allocations;
+	const PooledMatAllocator& pool = PooledMatAllocator::instance();
+	uint64_t heapAllocations = pool.heapAllocations();
+	uint64_t frameHeapAllocations = heapAllocations - lastHeapAllocations;
+	lastHeapAllocations = heapAllocations;
+	if (drawnFrames++ % residentEveryXFrames == 0) {
+		residentBytes = processResidentBytes();
+	}
+
+	frameRing->values(frameTimes);
+	decodeRing->values(decodeTimes);
+	latencyRing->values(latencies);
+	double frameSum = 0;
+	for (size_t i = 0; i < frameTimes.size(); i++) {
+		frameSum += frameTimes[i];
+	}
+	double fps = frameSum > 0 ? 1000 * frameTimes.size() / frameSum : 0;
+	double maxLatency = 0;
+	for (size_t i = 0; i < latencies.size(); i++) {
+		maxLatency = std::max(maxLatency, latencies[i]);
+	}
+
+	cvui::printf(where, x, y, 0.4, 0xCECECE, "Frame: %.1f ms, %.1f fps", frameTimes.empty() ? 0.0 : frameTimes.back(), fps);
+	cvui::sparkline(where, frameTimes, x, y + 15, width(), 30, 0x00ff00);
+	cvui::printf(where, x, y + 55, 0.4, 0xCECECE, "Decode: %.1f ms", decodeTimes.empty() ? 0.0 : decodeTimes.back());
+	cvui::sparkline(where, decodeTimes, x, y + 70, width(), 30, 0x00a0ff);
+	cvui::printf(where, x, y + 110, 0.4, 0xCECECE, "Mat allocations/frame: %u", (unsigned)frameAllocations);
+	if (pool.isInstalled()) {
+		cvui::printf(where, x, y + 130, 0.4, 0xCECECE, "Heap allocations/frame: %u, %.1f MB pooled", (unsigned)frameHeapAllocations, pool.pooledBytes() / (1024.0 * 1024.0));
+	}
+	else {
+		cvui::printf(where, x, y + 130, 0.4, 0xCECECE, "Mat pool off");
+	}
+	cvui::printf(where, x, y + 150, 0.4, 0xCECECE, "Input latency: %.1f ms, max %.1f ms", latencies.empty() ? 0.0 : latencies.back(), maxLatency);
+	cvui::printf(where, x, y + 170, 0.4, 0xCECECE, "Resident memory: %.1f MB", residentBytes / (1024.0 * 1024.0));
+}
@@ -0,0 +1,49 @@
+#ifndef PERFHUD_H
+#define PERFHUD_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <vector>
+
+#include "CountingMatAllocator.h"
+#include "Trace.h"
+
+// Overlay with frame and decode times, fps, Mat allocations per frame,
+// heap allocations of the Mat pool per frame, input latency and resident
+// memory. The times come from the trace rings of the "frame", "decode" and
+// "input latency" spans. Rings and allocation counting only run while the
+// HUD is visible.
+class PerfHud {
+public:
+	PerfHud();
+	~PerfHud();
+
+	void setVisible(bool visible);
+	bool isVisible() const { return visible; }
+	void toggle() { setVisible(!visible); }
+
+	// Draws the HUD with its top left corner at (x, y), once per frame.
+	// Needs width() x height() pixels.
+	void draw(cv::Mat& where, int x, int y);
+	static int width() { return 230; }
+	static int height() { return 190; }
+
+private:
+	bool visible;
+	TraceRing* frameRing;
+	TraceRing* decodeRing;
+	TraceRing* latencyRing;
+	std::vector<double> frameTimes;
+	std::vector<double> decodeTimes;
+	std::vector<double> latencies;
+	CountingMatAllocator allocator;
+	uint64_t lastAllocations;
+	uint64_t lastHeapAllocations;
+	uint32_t drawnFrames;
+	size_t residentBytes;
+};
+
+// Resident memory of this process, 0 if unknown.
+size_t processResidentBytes();
+
+#endif // PERFHUD_H
@@ -0,0 +1,160 @@
+#include "PooledMatAllocator.h"
+
+#include <new>
+
+// From the C API headers, which are not needed otherwise.
+#ifndef CV_AUTOSTEP
+	#define CV_AUTOSTEP 0x7fffffff
+#endif
+
+// Classes below this size all share class 0.
+const int minClassBits = 6;
+// Each power of two is split into this many classes.
+const int classSteps = 4;
+
+// Size class of a buffer and the number of bytes every buffer of the class has.
+static int sizeClass(size_t size, size_t& classSize)
+{
+	if (size <= ((size_t)1 << minClassBits)) {
+		classSize = (size_t)1 << minClassBits;
+		return 0;
+	}
+	int bits = minClassBits;
+	while (((size_t)1 << (bits + 1)) < size) {
+		bits++;
+	}
+	// size lies in (2^bits, 2^(bits + 1)], round up to the next quarter.
+	size_t quarter = (size_t)1 << (bits - 2);
+	size_t steps = (size - ((size_t)1 << bits) + quarter - 1) / quarter;
+	classSize = ((size_t)1 << bits) + steps * quarter;
+	return (bits - minClassBits) * classSteps + (int)steps;
+}
+
+PooledMatAllocator& PooledMatAllocator::instance()
+{
+	// Never destroyed, see the class comment.
+	static PooledMatAllocator* pool = new PooledMatAllocator();
+	return *pool;
+}
+
+PooledMatAllocator::PooledMatAllocator() : previous(0), installed(false), allocationCount(0), heapCount(0), pooledSize(0)
+{
+}
+
+cv::UMatData* PooledMatAllocator::allocate(int dims, const int* sizes, int type, void* data0, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+	// Same layout as the standard allocator.
+	size_t total = CV_ELEM_SIZE(type);
+	for (int i = dims - 1; i >= 0; i--) {
+		if (step) {
+			if (data0 && step[i] != CV_AUTOSTEP) {
+				CV_Assert(total <= step[i]);
+				total = step[i];
+			}
+			else {
+				step[i] = total;
+			}
+		}
+		total *= sizes[i];
+	}
+
+	uchar* data = (uchar*)data0;
+	void* header = 0;
+	size_t classSize = 0;
+	int index = data0 ? -1 : sizeClass(total, classSize);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!headers.empty()) {
+			header = headers.back();
+			headers.pop_back();
+		}
+		if (index >= 0 && index < (int)buffers.size() && !buffers[index].empty()) {
+			data = buffers[index].back();
+			buffers[index].pop_back();
+			pooledSize.fetch_sub(classSize, std::memory_order_relaxed);
+		}
+	}
+	if (header == 0) {
+		header = ::operator new(sizeof(cv::UMatData));
+	}
+	if (data == 0) {
+		data = (uchar*)cv::fastMalloc(classSize);
+		heapCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (!data0) {
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	cv::UMatData* u = new (header) cv::UMatData(this);
+	u->data = u->origdata = data;
+	u->size = total;
+	if (data0) {
+		u->flags |= cv::UMatData::USER_ALLOCATED;
+	}
+	return u;
+}
+
+bool PooledMatAllocator::allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const
+{
+	return data != 0;
+}
+
+void PooledMatAllocator::deallocate(cv::UMatData* u) const
+{
+	if (!u) {
+		return;
+	}
+	CV_Assert(u->urefcount == 0 && u->refcount == 0);
+	uchar* data = (u->flags & cv::UMatData::USER_ALLOCATED) ? 0 : u->origdata;
+	size_t classSize = 0;
+	int index = data ? sizeClass(u->size, classSize) : -1;
+	u->origdata = 0;
+	u->~UMatData();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	headers.push_back(u);
+	if (data) {
+		if (pooledSize.load(std::memory_order_relaxed) + classSize > maxPooledBytes) {
+			cv::fastFree(data);
+			return;
+		}
+		if (index >= (int)buffers.size()) {
+			buffers.resize(index + 1);
+		}
+		buffers[index].push_back(data);
+		pooledSize.fetch_add(classSize, std::memory_order_relaxed);
+	}
+}
+
+void PooledMatAllocator::install()
+{
+	if (!installed) {
+		previous = cv::Mat::getDefaultAllocator();
+		cv::Mat::setDefaultAllocator(this);
+		installed = true;
+	}
+}
+
+void PooledMatAllocator::uninstall()
+{
+	if (installed) {
+		cv::Mat::setDefaultAllocator(previous);
+		installed = false;
+	}
+}
+
+void PooledMatAllocator::trim()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < buffers.size(); i++) {
+		for (size_t j = 0; j < buffers[i].size(); j++) {
+			cv::fastFree(buffers[i][j]);
+		}
+		buffers[i].clear();
+	}
+	for (size_t i = 0; i < headers.size(); i++) {
+		::operator delete(headers[i]);
+	}
+	headers.clear();
+	pooledSize.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,63 @@
+#ifndef POOLEDMATALLOCATOR_H
+#define POOLEDMATALLOCATOR_H
+
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Idle buffers above this many bytes in total are freed instead of pooled.
+const size_t maxPooledBytes = (size_t)512 << 20;
+
+// Mat allocator that keeps freed buffers and their UMatData for reuse.
+// Buffer sizes are rounded up to size classes of a quarter of a power of
+// two, so a Mat that is created again with the same or a slightly smaller
+// size gets a buffer of the last frame back. Once every buffer of a frame
+// went through the pool, processing a frame does not touch the heap for
+// Mat data, which heapAllocations() shows.
+// There is one instance that is never destroyed, Mats may still hold pooled
+// buffers when static objects are destroyed.
+class PooledMatAllocator : public cv::MatAllocator {
+public:
+	static PooledMatAllocator& instance();
+
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const;
+	bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const;
+	void deallocate(cv::UMatData* data) const;
+
+	// Makes the pool the default allocator for new Mats, or restores the
+	// previous one. Pooled Mats allocated meanwhile still come back here.
+	void install();
+	void uninstall();
+	bool isInstalled() const { return installed; }
+
+	// Frees all idle buffers.
+	void trim();
+
+	// Buffers handed out, from the pool or the heap.
+	uint64_t allocations() const { return allocationCount.load(std::memory_order_relaxed); }
+	// Buffers that had to come from the heap.
+	uint64_t heapAllocations() const { return heapCount.load(std::memory_order_relaxed); }
+	// Bytes of idle buffers waiting for reuse.
+	size_t pooledBytes() const { return pooledSize.load(std::memory_order_relaxed); }
+
+private:
+	PooledMatAllocator();
+	PooledMatAllocator(const PooledMatAllocator&);
+	PooledMatAllocator& operator=(const PooledMatAllocator&);
+
+	cv::MatAllocator* previous;
+	bool installed;
+	mutable std::mutex mutex;
+	// Idle buffers per size class, see sizeClass() in the .cpp.
+	mutable std::vector<std::vector<uchar*> > buffers;
+	// Storage of destroyed UMatData, constructed again on reuse.
+	mutable std::vector<void*> headers;
+	mutable std::atomic<uint64_t> allocationCount;
+	mutable std::atomic<uint64_t> heapCount;
+	mutable std::atomic<size_t> pooledSize;
+};
+
+#endif // POOLEDMATALLOCATOR_H
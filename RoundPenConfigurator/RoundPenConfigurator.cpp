@@ -9,42 +9,110 @@
 #define CVUI_IMPLEMENTATION
 #include "cvui.h"
 #include "tinyfiledialogs.h"
+#include "HistogramModel.h"
+#include "HsvTileCache.h"
+#include "InputQueue.h"
+#include "InputReplay.h"
+#include "ConfigWriter.h"
+#include "MarkerConfig.h"
+#include "MarkerRegistry.h"
+#include "MarkerSeparability.h"
+#include "MotionRoi.h"
+#include "PerfHud.h"
+#include "PooledMatAllocator.h"
+#include "Trace.h"
+#include "VideoColorStats.h"
+#include "ZoomView.h"
 
 using namespace std;
 
 const int updateEveryXFrames = 20;
 const int configHeight = 200;
+// A colour covering more of the crop than this is more than a pen marker.
+const float backgroundShare = 0.01f;
 
-int main()
+// Markers a save writes, the new marker only once it has a name and a colour.
+static int completeMarkers(const MarkerRegistry& markers, bool colorSet)
 {
+	int count = markers.size();
+	if (markers.names[count - 1].empty() || !colorSet) {
+		count--;
+	}
+	return count;
+}
+
+int main(int argc, char** argv)
+{
+	// --trace[=file] writes a Chrome trace of all stages at exit.
+	traceFromArgs(argc, argv);
+	traceThreadName("main");
+	// Frame buffers are reused from frame to frame instead of going back to the heap.
+	PooledMatAllocator::instance().install();
+	// --record[=file] records mouse and keys, --replay[=file] plays them back without a window.
+	if (!inputFromArgs(argc, argv)) {
+		return -1;
+	}
+
     char const* lFilterPatterns[4] = { "*.avi", "*.mp4", "*.mkv", "*.mov" };
-    char const* selection = tinyfd_openFileDialog( // there is also a wchar_t version
-        "Select file", // title
-        "%homepath%\\Videos\\", // optional initial directory
-        4, // number of filter patterns
-        lFilterPatterns,
-        NULL, // optional filter description
-        0 // forbid multiple selections
-    );
+	char const* selection = inputReplayVideo();
+	if (selection == NULL) {
+		selection = tinyfd_openFileDialog( // there is also a wchar_t version
+			"Select file", // title
+			"%homepath%\\Videos\\", // optional initial directory
+			4, // number of filter patterns
+			lFilterPatterns,
+			NULL, // optional filter description
+			0 // forbid multiple selections
+		);
+	}
 	if (selection == nullptr) return 0;
+	inputRecordVideo(selection);
 	// const char* selection = "C:\\Users\\schwa\\Downloads\\dji.mov"; // Somehow it failed on this vid
 
     cv::VideoCapture cap;
 	cv::Mat frame;
 	cv::Mat frame_full;
-	cv::Mat hsv;
+	HsvTileCache hsvTiles;
     cv::Mat window;
 
-    char namesBuffer[2048];
-    namesBuffer[0] = 0;
-    uint16_t namesBufferLength = 0;
-    char* markerNames[16];
-	cv::Vec3b markerColors[16];
-	cv::Vec3b windowColors[16];
+	// The last marker is the one currently being defined,
+	// the ones before can be selected with TAB to edit them.
+	MarkerRegistry markers;
 	cv::Vec3b backgroundColor;
 	cv::Vec3b backgroundWindowColor;
-    markerNames[0] = namesBuffer;
-    uint8_t markersLength = 1;
+	// Samples of every click or drag, saved to markers.hist.
+	HistogramModel backgroundModel;
+
+	// Continue with the last saved configuration if there is one.
+	MarkerConfig config;
+	const char* loadedFrom = NULL;
+	if (inputReplaying()) {
+		// Start where the recording started, not from the files on disk now.
+		if (inputReplayConfig(config)) {
+			loadedFrom = "the recording";
+		}
+	}
+	else if (readBinary("markers.bin", config)) {
+		loadedFrom = "markers.bin";
+	}
+	else if (readCsv("markers.csv", config)) {
+		readHistograms("markers.hist", config);
+		loadedFrom = "markers.csv";
+	}
+	// The registry keeps one slot for the marker being defined.
+	if (loadedFrom != NULL && (int)config.names.size() > maxMarkers - 1) {
+		cerr << loadedFrom << " has more than " << maxMarkers - 1 << " markers, starting without it" << endl;
+		config = MarkerConfig();
+		loadedFrom = NULL;
+	}
+	inputRecordConfig(loadedFrom != NULL ? &config : NULL);
+	if (loadedFrom != NULL) {
+		markers.importFrom(config);
+		backgroundColor = config.backgroundColor;
+		backgroundWindowColor = windowColor(backgroundColor);
+		backgroundModel = config.backgroundModel;
+	}
+	int currentMarker = markers.add();
 
     cap.open(selection);
     if (!cap.isOpened()) {
@@ -52,12 +120,30 @@ int main()
         cerr << "Call the command with a valid video file as first parameter" << endl;
         return -1;
     }
+	// Looks for the region the markers move in while the first frames are shown.
+	// Off while replaying, the poll it arrives in depends on the machine and
+	// the recorded clicks would land on a different ROI.
+	MotionRoi motionRoi;
+	if (!inputReplaying()) {
+		motionRoi.start(selection);
+	}
 
-	while (cv::waitKey(20) != ' ') {
+	// CTRL+P shows frame times, allocations and memory.
+	PerfHud perfHud;
+    inputInit("RoundPen Configurator");
+	// Labels of the panel are only measured again when they change.
+	cvui::retained(true);
+
+	char key = 0;
+	while (key != ' ') {
+		TRACE_SCOPE("frame");
+		TraceScope decodeScope("decode");
 		if (!cap.read(frame_full)) {
 			cerr << "Error reading first frame" << endl;
 			return -1;
 		}
+		decodeScope.stop();
+		TraceScope resizeScope("resize");
 		double h1 = 1900 * (frame_full.rows / (double)frame_full.cols);
 		double w2 = 780 * (frame_full.cols / (double)frame_full.rows);
 		if (h1 <= 780) {
@@ -66,19 +152,60 @@ int main()
 		else {
 			cv::resize(frame_full, frame, cv::Size((int)w2, 780));
 		}
+		resizeScope.stop();
 		frame.copyTo(window);
 		cv::putText(window, "Press SPACE to stop for configurating markers.", cv::Point(15, 15), cv::FONT_HERSHEY_PLAIN, 1, CV_RGB(255, 0, 0), 2);
-		cv::imshow("RoundPen Configurator", window);
+		perfHud.draw(window, window.cols - PerfHud::width() - 10, window.rows - PerfHud::height() - 10);
+		// Also drops clicks made here, so they do not start a ROI.
+		cvui::update();
+		{
+			TRACE_SCOPE("imshow");
+			inputShow("RoundPen Configurator", window);
+		}
+		key = inputWaitKey(20);
+		if (inputFinished()) {
+			return 0;
+		}
+		if (key == 16) {
+			perfHud.toggle();
+		}
 	}
 
-    cvui::init("RoundPen Configurator");
-
 	int lowX = 0, lowY = 0, highX = frame.cols, highY = frame.rows;
-	while (cv::waitKey(20) != ' ') {
+	double toWindow = frame.rows / (double)frame_full.rows;
+	// Set once the region is loaded, dragged or proposed.
+	bool roiSet = false;
+	bool roiProposed = false;
+	// Start with the saved region if it fits into this video.
+	if (config.roi.area() > 0 && (config.roi & cv::Rect(0, 0, frame_full.cols, frame_full.rows)) == config.roi) {
+		roiSet = true;
+		lowX = (int)(config.roi.x * toWindow);
+		lowY = (int)(config.roi.y * toWindow);
+		highX = (int)(config.roi.br().x * toWindow);
+		highY = (int)(config.roi.br().y * toWindow);
+	}
+	while (inputWaitKey(20) != ' ') {
+		if (inputFinished()) {
+			return 0;
+		}
 		frame.copyTo(window);
 		cv::putText(window, "Press SPACE to go to configurating markers.", cv::Point(15, 15), cv::FONT_HERSHEY_PLAIN, 1, CV_RGB(255, 0, 0), 2);
+		cv::Rect proposed;
+		if (!roiSet && motionRoi.result(proposed)) {
+			lowX = (int)(proposed.x * toWindow);
+			lowY = (int)(proposed.y * toWindow);
+			highX = (int)(proposed.br().x * toWindow);
+			highY = (int)(proposed.br().y * toWindow);
+			roiSet = true;
+			roiProposed = true;
+		}
+		if (roiProposed) {
+			cv::putText(window, "Region proposed from the motion in the video, drag to change it.", cv::Point(15, 35), cv::FONT_HERSHEY_PLAIN, 1, CV_RGB(255, 0, 0), 2);
+		}
 
 		if (cvui::mouse(cvui::DOWN)) {
+			roiSet = true;
+			roiProposed = false;
 			lowX = cvui::mouse().x, lowY = cvui::mouse().y;
 		}
 		else if (cvui::mouse(cvui::IS_DOWN)) {
@@ -97,33 +224,54 @@ int main()
 				lowY = tmp;
 			}
 		}
+		TraceScope cvuiScope("cvui");
 		if(lowX-highX != 0 && lowY-highY != 0)
 			cvui::rect(window, min(lowX, highX), min(lowY, highY), abs(lowX - highX), abs(lowY - highY), 0xff0000, 0xeeff0000);
 		cvui::update();
-		cv::imshow("RoundPen Configurator", window);
+		cvuiScope.stop();
+		TRACE_SCOPE("imshow");
+		inputShow("RoundPen Configurator", window);
 	}
 
+	motionRoi.stop();
+
 	double scaling = ((double)(frame_full.rows)) / frame.rows;
 	lowX = max(0.0, lowX * scaling);
 	lowY = max(0.0, lowY * scaling);
 	highX = min((double)frame_full.cols, highX * scaling);
 	highY = min((double)frame_full.rows, highY * scaling);
-	frame_full = frame_full(cv::Rect(lowX, lowY, highX-lowX, highY-lowY));
+	// Saved with the markers, so a tracker can crop the same region.
+	cv::Rect roi(lowX, lowY, highX - lowX, highY - lowY);
+	frame_full = frame_full(roi);
+	// Scans the whole video while the markers are configured.
+	VideoColorStats videoStats;
+	videoStats.start(selection, roi);
 
 	double h1 = 1900 * (frame_full.rows / (double)frame_full.cols);
 	double w2 = 780 * (frame_full.cols / (double)frame_full.rows);
+	cv::Size viewSize;
 	if (h1 <= 780) {
-		cv::resize(frame_full, frame, cv::Size(1900, (int)h1));
-	}
-	else if (w2 <= 1900) {
-		cv::resize(frame_full, frame, cv::Size((int)w2, 780));
+		viewSize = cv::Size(1900, (int)h1);
 	}
 	else {
-		cv::resize(frame_full, frame, cv::Size(1900, 780));
+		viewSize = cv::Size((int)w2, 780);
+	}
+
+	// The view shows the crop zoomed and panned, colours are always
+	// sampled from the full resolution crop. Only the tiles around the
+	// sampled pixels are converted to HSV.
+	ZoomView zoomView;
+	{
+		TRACE_SCOPE("pyramid");
+		zoomView.build(frame_full, viewSize);
 	}
+	hsvTiles.reset(frame_full);
+	window.create(viewSize.height + configHeight, viewSize.width, CV_8UC3);
+	cv::Mat view = window(cv::Rect(0, 0, viewSize.width, viewSize.height));
+	cv::Mat configArea = window(cv::Rect(0, viewSize.height, viewSize.width, configHeight));
 
-	cv::cvtColor(frame, hsv, cv::COLOR_BGR2HSV);
-    frame.push_back(cv::Mat(200, frame.cols, frame.type(), cv::Scalar::all(0)));
+	// Last position of a right button drag, for panning.
+	cv::Point lastPanPos(-1, -1);
 
 	// Variable to stop application.
     bool running = true;
@@ -132,11 +280,26 @@ int main()
 	char errorMsg[128];
 	errorMsg[0] = 0;
 
+	// How the current colour shows up over the whole video, updated with the cursor.
+	char statsMsg[192];
+	statsMsg[0] = 0;
+
+	// How often the markers are taken for each other over the whole video.
+	MarkerSeparability separability;
+	std::vector<uint64_t> videoPixels;
+	// Set once a save was refused for confusion, the next try saves the same
+	// markers anyway. Any change to the models asks again.
+	bool confusionWarned = false;
+	int warnedMarkers = 0;
+
 	// Save message to print.
 	char saveMsg[128];
 	saveMsg[0] = 0;
+	if (loadedFrom != NULL) {
+		snprintf(saveMsg, sizeof(saveMsg), "Loaded %d markers from %s.", markers.size() - 1, loadedFrom);
+	}
 
-	// Variable to check if user have set a color for current marker.
+	// Variable to check if user have set a color for the new marker.
 	bool colorSet = false;
 
 	// UI Padding for config.
@@ -151,11 +314,16 @@ int main()
 	// Select background
 	bool selectBackground = true;
 
+	// Last position samples were taken from, so holding the mouse still
+	// does not add the same pixels every frame.
+	cv::Point lastSamplePos(-1, -1);
+
 	// Saving related variables.
 	// Just here so it doesnt need to be created multiple times.
 	int markersToSave;
-	char markerColorStringBuffer[10];
-	ofstream outfile;
+	bool saveOk;
+	// Writes markers.csv, markers.hist and markers.bin in the background.
+	ConfigWriter configWriter(inputConfigBase());
 
     while (running) {
 		if (frameNr%updateEveryXFrames == 0) {
@@ -165,18 +333,50 @@ int main()
 			else {
 				cursor = 0;
 			}
+			const HistogramModel& model = selectBackground ? backgroundModel : markers.models[currentMarker];
+			ColorCoverage coverage;
+			if (videoStats.coverage(model, backgroundShare, coverage)) {
+				snprintf(statsMsg, sizeof(statsMsg), "Whole video (%d/%d s scanned): colour covers over %.0f%% of the crop in %.0f%% of seconds, at most %.0f%%.",
+					videoStats.scanned(), videoStats.total(), backgroundShare * 100, coverage.seconds * 100, coverage.maxShare * 100);
+			}
+			else {
+				statsMsg[0] = 0;
+			}
+			// The same markers the check before saving looks at.
+			int complete = completeMarkers(markers, colorSet);
+			if (!selectBackground && complete > 0 && videoStats.binTotals(videoPixels)) {
+				separability.update(videoPixels, backgroundModel, &markers.models[0], complete);
+			}
+			else {
+				separability.confusion.release();
+			}
+		}
+		TRACE_SCOPE("frame");
+		TraceScope renderScope("zoom render");
+		zoomView.render(view);
+		configArea.setTo(cv::Scalar::all(0));
+		renderScope.stop();
+		TraceScope cvuiScope("cvui");
+		// The matrix gets its own column below the controls, left of the performance HUD,
+		// if the window is wide enough. The rows next to it are cut off at the column.
+		int textRight = window.cols - PerfHud::width() - 20;
+		int separabilityX = textRight - separability.width();
+		bool showSeparability = !selectBackground && !separability.confusion.empty() && separabilityX >= window.cols / 2;
+		cv::Mat textArea = window;
+		if (showSeparability) {
+			textRight = separabilityX - 10;
+			textArea = window(cv::Rect(0, 0, textRight, window.rows));
 		}
-        frame.copyTo(window);
 		padding = 10;
 		if (selectBackground) {
 			cvui::text(window, 10, window.rows - configHeight + padding, "Click on a pixel in the window to define the background.");
 			padding += 20;
-			cvui::text(window, 10, window.rows - configHeight + padding, "Controls: Left-Click = Select Color, SPACE or Enter = Next, Esc = Exit.");
+			cvui::text(window, 10, window.rows - configHeight + padding, "Controls: Left-Click = Select Color, SPACE or Enter = Next, CTRL+E/CTRL+Q = Zoom In/Out, Right-Drag = Pan, CTRL+R = Reset Samples, CTRL+P = Performance, Esc = Exit.");
 		}
 		else {
 			cvui::text(window, 10, window.rows - configHeight + padding, "Click on a pixel in the window to define a new marker.");
 			padding += 20;
-			cvui::text(window, 10, window.rows - configHeight + padding, "Controls: Left-Click = Select Color, Typing = Set Name, Enter = Next, CTRL+T = Save, Esc = Exit.");
+			cvui::text(window, 10, window.rows - configHeight + padding, "Controls: Left-Click = Select Color, Typing = Set Name, Enter = Next, TAB = Select Marker, CTRL+E/CTRL+Q = Zoom, Right-Drag = Pan, CTRL+R = Reset Samples, CTRL+D = Delete Marker, CTRL+T = Save, CTRL+P = Performance, Esc = Exit.");
 		}
 		padding += 20;
 		if (selectBackground) {
@@ -184,31 +384,85 @@ int main()
 			int color = ((backgroundWindowColor[0]) << 0) + ((backgroundWindowColor[1]) << 8) + ((backgroundWindowColor[2]) << 16);
 			cvui::rect(window, 86, window.rows - configHeight + padding - 2, 16, 16, 0, color);
 			padding += 20;
-			cvui::printf(window, 10, window.rows - configHeight + padding, "Current color (HSV 360/100/100): %d %d %d", backgroundColor[0] * 2, backgroundColor[1] * 100 / 256, backgroundColor[2] * 100 / 256);
+			cvui::printf(window, 10, window.rows - configHeight + padding, "Current color (HSV 360/100/100): %d %d %d, samples: %u", backgroundColor[0] * 2, backgroundColor[1] * 100 / 256, backgroundColor[2] * 100 / 256, backgroundModel.samples);
 		}
 		else {
-			cvui::printf(window, 10, window.rows - configHeight + padding, "Markers: %s%c", namesBuffer, cursor);
+			// Not printf, the names can be longer than its buffer.
+			string namesText = "Markers: ";
+			for (int i = 0; i < markers.size(); i++) {
+				if (i > 0) {
+					namesText += ",";
+				}
+				namesText += markers.names[i];
+				if (i == currentMarker && cursor) {
+					namesText += cursor;
+				}
+			}
+			cvui::text(textArea, 10, window.rows - configHeight + padding, namesText);
 			padding += 20;
-			cvui::text(window, 10, window.rows - configHeight + padding, "Colors:");
-			for (int i = 0; i < markersLength; i++) {
-				cvui::printf(window, 69 + 30 * i, window.rows - configHeight + padding, "%d", i);
-				int color = ((windowColors[i][0]) << 0) + ((windowColors[i][1]) << 8) + ((windowColors[i][2]) << 16);
-				cvui::rect(window, 79 + 30 * i, window.rows - configHeight + padding - 2, 16, 16, 0, color);
+			cvui::text(textArea, 10, window.rows - configHeight + padding, "Colors:");
+			// As many as fit left of the matrix and the performance HUD, scrolled so the current marker is visible.
+			// Three digit numbers need more room.
+			int colorPitch = markers.size() > 100 ? 40 : 30;
+			int visibleColors = max(1, (textRight - 79) / colorPitch);
+			int firstColor = max(0, min(currentMarker - visibleColors / 2, markers.size() - visibleColors));
+			for (int i = firstColor; i < markers.size() && i < firstColor + visibleColors; i++) {
+				int x = 79 + colorPitch * (i - firstColor);
+				cvui::printf(textArea, x - colorPitch + 20, window.rows - configHeight + padding, "%d", i);
+				int color = ((markers.windowColors[i][0]) << 0) + ((markers.windowColors[i][1]) << 8) + ((markers.windowColors[i][2]) << 16);
+				cvui::rect(textArea, x, window.rows - configHeight + padding - 2, 16, 16, i == currentMarker ? 0xffffff : 0, color);
 			}
 			padding += 20;
-			cvui::printf(window, 10, window.rows - configHeight + padding, "Current color (HSV 360/100/100): %d %d %d", markerColors[markersLength - 1][0] * 2, markerColors[markersLength - 1][1] * 100 / 256, markerColors[markersLength - 1][2] * 100 / 256);
+			cvui::printf(textArea, 10, window.rows - configHeight + padding, "Current color (HSV 360/100/100): %d %d %d, samples: %u", markers.colors[currentMarker][0] * 2, markers.colors[currentMarker][1] * 100 / 256, markers.colors[currentMarker][2] * 100 / 256, markers.models[currentMarker].samples);
 		}
 		padding += 20;
-		cvui::text(window, 10, window.rows - configHeight + padding, errorMsg, 0.4, 0xff0000);
+		cvui::text(textArea, 10, window.rows - configHeight + padding, errorMsg, 0.4, 0xff0000);
 		padding += 20;
-		cvui::text(window, 10, window.rows - 10, saveMsg, 0.4, 0xff00);
+		cvui::text(textArea, 10, window.rows - configHeight + padding, statsMsg, 0.4, 0xCECECE);
+		padding += 20;
+		if (showSeparability) {
+			separability.draw(window, separabilityX, window.rows - configHeight + 55);
+		}
+		else if (!selectBackground && !separability.confusion.empty()) {
+			// Too narrow for the matrix, the worst pair is enough to see what a save warns about.
+			char worstText[96];
+			separability.describeWorst(worstText, sizeof(worstText));
+			cvui::text(window, 10, window.rows - configHeight + padding, worstText, 0.4, separability.worst > maxMarkerConfusion ? 0xff0000 : 0xCECECE);
+		}
+		cvui::text(textArea, 10, window.rows - 10, saveMsg, 0.4, 0xff00);
+		perfHud.draw(window, window.cols - PerfHud::width() - 10, window.rows - configHeight + 10);
+		cvuiScope.stop();
+
+		if (cvui::mouse(cvui::RIGHT_BUTTON, cvui::IS_DOWN)) {
+			if (lastPanPos.x >= 0) {
+				zoomView.pan(cvui::mouse().x - lastPanPos.x, cvui::mouse().y - lastPanPos.y);
+			}
+			lastPanPos = cvui::mouse();
+		}
+		else {
+			lastPanPos = cv::Point(-1, -1);
+		}
 
         if (cvui::mouse(cvui::IS_DOWN)) {
 			cv::Point pos(cvui::mouse().x, cvui::mouse().y);
-			if (pos.x >= 0 && pos.x < hsv.cols && pos.y >= 0 && pos.y < hsv.rows) {
+			if (pos.x >= 0 && pos.x < view.cols && pos.y >= 0 && pos.y < view.rows) {
+				// Full resolution pixel under the mouse.
+				cv::Point imagePos = zoomView.toImage(pos);
+				// Every click or drag adds the 3x3 neighbourhood to the histogram model.
+				if (imagePos != lastSamplePos || cvui::mouse(cvui::DOWN)) {
+					cv::Mat patch = hsvTiles.region(cv::Rect(imagePos.x - 1, imagePos.y - 1, 3, 3));
+					if (selectBackground) {
+						backgroundModel.addPatch(patch);
+					}
+					else {
+						markers.models[currentMarker].addPatch(patch);
+					}
+					lastSamplePos = imagePos;
+					confusionWarned = false;
+				}
 				if (selectBackground) {
-					backgroundColor = hsv.at<cv::Vec3b>(pos);
-					backgroundWindowColor = window.at<cv::Vec3b>(pos);
+					backgroundColor = hsvTiles.at(imagePos);
+					backgroundWindowColor = frame_full.at<cv::Vec3b>(imagePos);
 
 					if (pos.x > 15 && pos.y > 15) {
 						int color = ((backgroundWindowColor[0]) << 0) + ((backgroundWindowColor[1]) << 8) + ((backgroundWindowColor[2]) << 16);
@@ -219,109 +473,203 @@ int main()
 					}
 				}
 				else {
-					markerColors[markersLength - 1] = hsv.at<cv::Vec3b>(pos);
-					windowColors[markersLength - 1] = window.at<cv::Vec3b>(pos);
+					markers.colors[currentMarker] = hsvTiles.at(imagePos);
+					markers.windowColors[currentMarker] = frame_full.at<cv::Vec3b>(imagePos);
 
 					if (pos.x > 15 && pos.y > 15) {
-						int color = ((windowColors[markersLength - 1][0]) << 0) + ((windowColors[markersLength - 1][1]) << 8) + ((windowColors[markersLength - 1][2]) << 16);
+						int color = ((markers.windowColors[currentMarker][0]) << 0) + ((markers.windowColors[currentMarker][1]) << 8) + ((markers.windowColors[currentMarker][2]) << 16);
 						cv::Point pos2(pos.x - 15, pos.y - 15);
 						cv::circle(window, pos2, 15, cv::Scalar(255, 255, 255), -1);
 						cv::circle(window, pos2, 15, cv::Scalar(0, 0, 0), 1);
 						cvui::rect(window, pos2.x - 10, pos2.y - 10, 20, 20, 0x000000, color);
 					}
 				}
-				colorSet = true;
+				if (!selectBackground && currentMarker == markers.size() - 1) {
+					colorSet = true;
+				}
 				saveMsg[0] = 0;
 			}
         }
+		else {
+			lastSamplePos = cv::Point(-1, -1);
+		}
+
+		if (configWriter.poll(saveOk)) {
+			strcpy_s(saveMsg, saveOk ? "Configuration saved.\0" : "Saving configuration failed.\0");
+		}
 
         // This function must be called *AFTER* all UI components. It does
         // all the behind the scenes magic to handle mouse clicks, etc.
-        cvui::update();
+        {
+			TRACE_SCOPE("cvui update");
+			cvui::update();
+		}
 
         // Show everything on the screen
-        cv::imshow("RoundPen Configurator", window);
-
-        // Check if ESC key was pressed
-        char k = cv::waitKey(20);
-        switch (k) {
-        case 27:
-            running = false;
-            break;
-        case 13:
-			if (selectBackground) {
-				selectBackground = false;
-			}
-			else {
-				if (markerNames[markersLength - 1] != namesBuffer + namesBufferLength) {
-					if (colorSet) {
+        {
+			TRACE_SCOPE("imshow");
+			inputShow("RoundPen Configurator", window);
+		}
+		inputShown();
+
+        // Handle every key typed since the last frame, check if ESC key was pressed
+		{
+			TRACE_SCOPE("waitKey");
+			inputPoll(20);
+		}
+		// The keys of the last recorded poll are still handled.
+		if (inputFinished()) {
+			running = false;
+		}
+		int key;
+		while (inputNextKey(key)) {
+			char k = (char)key;
+			switch (k) {
+			case 27:
+				running = false;
+				break;
+			case 13:
+				if (selectBackground) {
+					selectBackground = false;
+				}
+				else if (currentMarker < markers.size() - 1) {
+					// Done editing a saved marker, back to the new one.
+					if (!markers.names[currentMarker].empty()) {
 						errorMsg[0] = 0;
-						// Add , to the end of the char string.
-						namesBuffer[namesBufferLength] = ',';
-						namesBufferLength++;
-						// The next string has 0 at the start. Will be overwritten.
-						namesBuffer[namesBufferLength] = 0;
-						// Point to the start of the new name.
-						markerNames[markersLength] = namesBuffer + namesBufferLength;
-						// Color not set for new marker.
-						colorSet = false;
-						// Increase the names.
-						markersLength++;
+						currentMarker = markers.size() - 1;
 					}
 					else {
-						strcpy_s(errorMsg, "Marker Color not set\0");
+						strcpy_s(errorMsg, "Marker Name not set\0");
 					}
 				}
 				else {
-					strcpy_s(errorMsg, "Marker Name not set\0");
+					if (!markers.names[currentMarker].empty()) {
+						if (!colorSet) {
+							strcpy_s(errorMsg, "Marker Color not set\0");
+						}
+						else if (markers.size() == maxMarkers) {
+							strcpy_s(errorMsg, "Too many markers\0");
+						}
+						else {
+							errorMsg[0] = 0;
+							currentMarker = markers.add();
+							// Color not set for new marker.
+							colorSet = false;
+						}
+					}
+					else {
+						strcpy_s(errorMsg, "Marker Name not set\0");
+					}
 				}
-			}
-            break;
-        case 8:
-            if (markerNames[markersLength - 1] != namesBuffer + namesBufferLength) {
-                namesBufferLength--;
-                namesBuffer[namesBufferLength] = 0;
+				break;
+			case 18:
+				if (selectBackground) {
+					backgroundModel.clear();
+				}
+				else {
+					markers.models[currentMarker].clear();
+				}
+				confusionWarned = false;
 				saveMsg[0] = 0;
-            }
-            break;
-        case 20:
-			if (!selectBackground) {
-				markersToSave = markersLength;
-				if (markerNames[markersLength - 1] == namesBuffer + namesBufferLength || !colorSet) {
-					markersToSave--;
+				break;
+			case 4:
+				// Delete the current marker and continue with the one before.
+				if (!selectBackground) {
+					if (currentMarker < markers.size() - 1) {
+						markers.remove(currentMarker);
+						currentMarker = markers.size() - 1;
+					}
+					else if (markers.size() > 1) {
+						markers.remove(currentMarker);
+						currentMarker = markers.size() - 1;
+						colorSet = true;
+					}
+					else {
+						markers.clear();
+						currentMarker = markers.add();
+						colorSet = false;
+					}
+					confusionWarned = false;
+					errorMsg[0] = 0;
+					saveMsg[0] = 0;
+				}
+				break;
+			case 9:
+				if (!selectBackground) {
+					if (!markers.names[currentMarker].empty() || currentMarker == markers.size() - 1) {
+						errorMsg[0] = 0;
+						currentMarker = (currentMarker + 1) % markers.size();
+					}
+					else {
+						strcpy_s(errorMsg, "Marker Name not set\0");
+					}
+				}
+				break;
+			case 16:
+				perfHud.toggle();
+				break;
+			case 5:
+				zoomView.zoomAt(cvui::mouse(), 2);
+				break;
+			case 17:
+				zoomView.zoomAt(cvui::mouse(), 0.5);
+				break;
+			case 8:
+				if (!markers.names[currentMarker].empty()) {
+					markers.names[currentMarker].pop_back();
+					saveMsg[0] = 0;
 				}
-				if (markersToSave > 0) {
-					outfile.open("markers.csv", ios::out | ios::trunc);
-					outfile << "Background;" << static_cast<unsigned>(backgroundColor[0]) << ";" << static_cast<unsigned>(backgroundColor[1]) << ";" << static_cast<unsigned>(backgroundColor[2]) << endl;
+				break;
+			case 20:
+				if (!selectBackground) {
+					markersToSave = completeMarkers(markers, colorSet);
 					for (int i = 0; i < markersToSave; i++) {
-						if (i < markersLength - 1) {
-							*(markerNames[i + 1] - 1) = 0;
-							outfile << markerNames[i] << ";" << static_cast<unsigned>(markerColors[i][0]) << ";" << static_cast<unsigned>(markerColors[i][1]) << ";" << static_cast<unsigned>(markerColors[i][2]) << endl;
-							*(markerNames[i + 1] - 1) = ',';
+						if (markers.names[i].empty()) {
+							strcpy_s(errorMsg, "Marker Name not set\0");
+							markersToSave = 0;
 						}
-						else {
-							outfile << markerNames[i] << ";" << static_cast<unsigned>(markerColors[i][0]) << ";" << static_cast<unsigned>(markerColors[i][1]) << ";" << static_cast<unsigned>(markerColors[i][2]) << endl;
+					}
+					// A full registry could not be loaded again with a slot for a new marker.
+					if (markersToSave > maxMarkers - 1) {
+						strcpy_s(errorMsg, "Too many markers\0");
+						markersToSave = 0;
+					}
+					// Warn once about markers that are taken for each other in the video.
+					if (markersToSave > 0 && videoStats.binTotals(videoPixels)) {
+						separability.update(videoPixels, backgroundModel, &markers.models[0], markersToSave);
+						if (separability.worst > maxMarkerConfusion && !(confusionWarned && warnedMarkers == markersToSave)) {
+							char worstText[96];
+							separability.describeWorst(worstText, sizeof(worstText));
+							snprintf(errorMsg, sizeof(errorMsg), "%s, CTRL+T again to save anyway.", worstText);
+							confusionWarned = true;
+							warnedMarkers = markersToSave;
+							markersToSave = 0;
 						}
 					}
-					outfile.close();
-					strcpy_s(saveMsg, "Configuration saved.\0");
+					if (markersToSave > 0) {
+						confusionWarned = false;
+						markers.exportTo(config, markersToSave);
+						config.backgroundColor = backgroundColor;
+						config.backgroundModel = backgroundModel;
+						config.roi = roi;
+						configWriter.save(config);
+						strcpy_s(saveMsg, "Saving configuration...\0");
+					}
+				}
+				break;
+			case ' ':
+				if (selectBackground) {
+					selectBackground = false;
+					break;
+				}
+			default:
+				if (!selectBackground && (k >= 'A' && k <= 'Z' || k >= 'a' && k <= 'z' || k >= '0' && k <= '9' || k == '_' || k == '-' || k == ' ')) {
+					markers.names[currentMarker] += k;
+					saveMsg[0] = 0;
 				}
-			}
-            break;
-		case ' ':
-			if (selectBackground) {
-				selectBackground = false;
 				break;
 			}
-        default:
-            if (!selectBackground && (k >= 'A' && k <= 'Z' || k >= 'a' && k <= 'z' || k >= '0' && k <= '9' || k == '_' || k == '-' || k == ' ')) {
-                namesBuffer[namesBufferLength] = k;
-                namesBufferLength++;
-                namesBuffer[namesBufferLength] = 0;
-				saveMsg[0] = 0;
-            }
-            break;
-        }
+		}
 		frameNr++;
     }
 }
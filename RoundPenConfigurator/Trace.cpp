@@ -0,0 +1,242 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+std::atomic<bool> traceOn(false);
+
+namespace {
+
+const int traceChunkEvents = 4096;
+const int maxTraceRings = 16;
+
+std::atomic<bool> fileOn(false);
+std::atomic<bool> ringsOn(false);
+
+// Rings are only added, a ring is visible to traceRecord() once ringCount includes it.
+TraceRing* rings[maxTraceRings];
+std::atomic<int> ringCount(0);
+
+struct TraceEvent {
+	const char* name;
+	int64_t start;
+	int64_t end;
+};
+
+// Events are appended to chunks that are never moved, so the writer can
+// read the published part of a chunk while its thread keeps appending.
+struct TraceChunk {
+	TraceChunk() : count(0), next(0) {}
+	TraceEvent events[traceChunkEvents];
+	std::atomic<int> count;
+	std::atomic<TraceChunk*> next;
+};
+
+struct TraceBuffer {
+	TraceBuffer(int tid) : tid(tid), name(0), first(new TraceChunk()), last(first) {}
+	int tid;
+	std::atomic<const char*> name;
+	TraceChunk* first;
+	// Only used by the owning thread.
+	TraceChunk* last;
+};
+
+std::mutex registryMutex;
+// Buffers stay alive until the end of the program, also of finished threads.
+std::vector<TraceBuffer*> buffers;
+std::string outputPath;
+bool atExitRegistered = false;
+const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+
+// Created with the first event, threads that never record cost nothing.
+thread_local TraceBuffer* currentBuffer = 0;
+thread_local const char* currentThreadName = 0;
+
+TraceBuffer* threadBuffer()
+{
+	if (currentBuffer == 0) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		currentBuffer = new TraceBuffer((int)buffers.size() + 1);
+		currentBuffer->name.store(currentThreadName);
+		buffers.push_back(currentBuffer);
+	}
+	return currentBuffer;
+}
+
+void writeEscaped(std::ofstream& out, const char* text)
+{
+	for (; *text; text++) {
+		if (*text == '"' || *text == '\\') {
+			out << '\\';
+		}
+		out << *text;
+	}
+}
+
+void traceAtExit()
+{
+	traceStop();
+}
+
+}
+
+int64_t traceNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+TraceRing::TraceRing(const char* name) : name(name), written(0)
+{
+	for (int i = 0; i < traceRingSize; i++) {
+		samples[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void TraceRing::push(float ms)
+{
+	// Every push claims its own slot, so threads pushing at once never share one.
+	uint32_t index = written.fetch_add(1, std::memory_order_acq_rel) % traceRingSize;
+	samples[index].store(ms, std::memory_order_release);
+}
+
+void TraceRing::values(std::vector<double>& out) const
+{
+	uint32_t total = count();
+	uint32_t n = total < (uint32_t)traceRingSize ? total : traceRingSize;
+	out.resize(n);
+	for (uint32_t i = 0; i < n; i++) {
+		out[i] = samples[(total - n + i) % traceRingSize].load(std::memory_order_relaxed);
+	}
+}
+
+TraceRing* traceRing(const char* name)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	int count = ringCount.load();
+	for (int i = 0; i < count; i++) {
+		if (strcmp(rings[i]->name, name) == 0) {
+			return rings[i];
+		}
+	}
+	if (count == maxTraceRings) {
+		return 0;
+	}
+	rings[count] = new TraceRing(name);
+	ringCount.store(count + 1, std::memory_order_release);
+	return rings[count];
+}
+
+void traceRingsEnable(bool enable)
+{
+	ringsOn = enable;
+	traceOn = fileOn || ringsOn;
+}
+
+static void recordRing(const char* name, int64_t start, int64_t end)
+{
+	int count = ringCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; i++) {
+		if (rings[i]->name == name || strcmp(rings[i]->name, name) == 0) {
+			rings[i]->push((end - start) / 1e6f);
+			return;
+		}
+	}
+}
+
+void traceRecord(const char* name, int64_t start, int64_t end)
+{
+	if (ringsOn.load(std::memory_order_relaxed)) {
+		recordRing(name, start, end);
+	}
+	if (!fileOn.load(std::memory_order_relaxed)) {
+		return;
+	}
+	TraceBuffer* buffer = threadBuffer();
+	TraceChunk* chunk = buffer->last;
+	int count = chunk->count.load(std::memory_order_relaxed);
+	if (count == traceChunkEvents) {
+		TraceChunk* next = new TraceChunk();
+		chunk->next.store(next, std::memory_order_release);
+		buffer->last = chunk = next;
+		count = 0;
+	}
+	TraceEvent& event = chunk->events[count];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	// Publishes the event to the writer.
+	chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void traceThreadName(const char* name)
+{
+	currentThreadName = name;
+	if (currentBuffer != 0) {
+		currentBuffer->name.store(name);
+	}
+}
+
+void traceStart(const char* path)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	outputPath = path;
+	if (!atExitRegistered) {
+		atexit(traceAtExit);
+		atExitRegistered = true;
+	}
+	fileOn = true;
+	traceOn = true;
+}
+
+void traceFromArgs(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--trace") == 0) {
+			traceStart("trace.json");
+		}
+		else if (strncmp(argv[i], "--trace=", 8) == 0) {
+			traceStart(argv[i] + 8);
+		}
+	}
+}
+
+void traceStop()
+{
+	if (!fileOn.exchange(false)) {
+		return;
+	}
+	traceOn = ringsOn.load();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	std::ofstream out(outputPath.c_str(), std::ios::out | std::ios::trunc);
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (size_t i = 0; i < buffers.size(); i++) {
+		const char* threadName = buffers[i]->name.load();
+		if (threadName != 0) {
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffers[i]->tid << ",\"args\":{\"name\":\"";
+			writeEscaped(out, threadName);
+			out << "\"}}";
+			first = false;
+		}
+		for (TraceChunk* chunk = buffers[i]->first; chunk != 0; chunk = chunk->next.load(std::memory_order_acquire)) {
+			int count = chunk->count.load(std::memory_order_acquire);
+			for (int e = 0; e < count; e++) {
+				const TraceEvent& event = chunk->events[e];
+				// Microseconds with fractions, as expected by the viewer.
+				out << (first ? "" : ",\n") << "{\"name\":\"";
+				writeEscaped(out, event.name);
+				out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffers[i]->tid
+					<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+				first = false;
+			}
+		}
+	}
+	out << "\n]}\n";
+}
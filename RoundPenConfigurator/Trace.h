@@ -0,0 +1,87 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+// Scoped tracing in the Chrome trace format (chrome://tracing, Perfetto).
+// Every thread appends to its own buffer without locking, the buffers are
+// only read when the trace is written. While tracing is off a scope costs
+// one relaxed load.
+
+// Set while spans are recorded, to a trace file or to rings.
+extern std::atomic<bool> traceOn;
+
+// Starts recording and writes the trace to path when the program exits.
+void traceStart(const char* path);
+// Writes the trace now and stops recording.
+void traceStop();
+// Name of the calling thread in the trace.
+void traceThreadName(const char* name);
+
+// Starts tracing if argv contains --trace or --trace=path.
+// The default path is trace.json.
+void traceFromArgs(int argc, char** argv);
+
+// Durations of the last traceRingSize spans with one name, kept while
+// rings are enabled, also without a trace file. Any thread may add, each
+// push claims a slot with an atomic increment. values() is meant for a
+// single reader such as the performance HUD and may see the previous value
+// of a slot whose push has not stored its sample yet.
+const int traceRingSize = 240;
+
+class TraceRing {
+public:
+	explicit TraceRing(const char* name);
+
+	void push(float ms);
+	// Milliseconds, oldest first.
+	void values(std::vector<double>& out) const;
+	// Spans added so far.
+	uint32_t count() const { return written.load(std::memory_order_acquire); }
+
+	const char* const name;
+
+private:
+	std::atomic<float> samples[traceRingSize];
+	std::atomic<uint32_t> written;
+};
+
+// Ring for spans named name, created on first use. At most 16 rings.
+TraceRing* traceRing(const char* name);
+void traceRingsEnable(bool enable);
+
+// Nanoseconds of a steady clock.
+int64_t traceNow();
+// Records a finished span. name must outlive the trace, e.g. a literal.
+void traceRecord(const char* name, int64_t start, int64_t end);
+
+class TraceScope {
+public:
+	explicit TraceScope(const char* name) : name(traceOn.load(std::memory_order_relaxed) ? name : 0), start(this->name ? traceNow() : 0) {}
+	~TraceScope() { stop(); }
+
+	// Ends the span before the end of the block.
+	void stop()
+	{
+		if (name) {
+			traceRecord(name, start, traceNow());
+			name = 0;
+		}
+	}
+
+private:
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+
+	const char* name;
+	int64_t start;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+// Records the time until the end of the enclosing block.
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif // TRACE_H
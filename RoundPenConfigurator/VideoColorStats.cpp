@@ -0,0 +1,167 @@
+#include "VideoColorStats.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <math.h>
+
+#include "Trace.h"
+
+// Same as the defaults of BackProjectionLut, darker pixels carry no reliable hue.
+static const float statsMinProbability = 0.05f;
+static const int statsMinValue = 30;
+
+VideoColorStats::VideoColorStats() : samplePixels(0), totalSeconds(0), stopping(false), finished(false)
+{
+}
+
+VideoColorStats::~VideoColorStats()
+{
+	stop();
+}
+
+void VideoColorStats::start(const std::string& path, const cv::Rect& roi)
+{
+	stop();
+	histograms.clear();
+	samplePixels = 0;
+	totalSeconds = 0;
+	stopping = false;
+	finished = false;
+	worker = std::thread(&VideoColorStats::run, this, path, roi);
+}
+
+void VideoColorStats::stop()
+{
+	if (worker.joinable()) {
+		stopping = true;
+		worker.join();
+	}
+}
+
+int VideoColorStats::scanned() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return (int)(histograms.size() / (histHueBins * histSatBins));
+}
+
+bool VideoColorStats::coverage(const HistogramModel& model, float minShare, ColorCoverage& out) const
+{
+	if (model.samples == 0) {
+		return false;
+	}
+	// Indices of the bins that count as this colour.
+	std::vector<int> colorBins;
+	for (int hb = 0; hb < histHueBins; hb++) {
+		for (int sb = 0; sb < histSatBins; sb++) {
+			if (model.probability(hb * 180 / histHueBins, sb * 256 / histSatBins) >= statsMinProbability) {
+				colorBins.push_back(hb * histSatBins + sb);
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t seconds = histograms.size() / (histHueBins * histSatBins);
+	if (seconds == 0 || samplePixels == 0) {
+		return false;
+	}
+	int covered = 0;
+	uint32_t maxPixels = 0;
+	for (size_t i = 0; i < seconds; i++) {
+		const uint16_t* bins = &histograms[i * histHueBins * histSatBins];
+		uint32_t pixels = 0;
+		for (size_t b = 0; b < colorBins.size(); b++) {
+			pixels += bins[colorBins[b]];
+		}
+		if (pixels > minShare * samplePixels) {
+			covered++;
+		}
+		maxPixels = std::max(maxPixels, pixels);
+	}
+	out.seconds = covered / (float)seconds;
+	out.maxShare = maxPixels / (float)samplePixels;
+	return true;
+}
+
+bool VideoColorStats::binTotals(std::vector<uint64_t>& totals) const
+{
+	const int binCount = histHueBins * histSatBins;
+	totals.assign(binCount, 0);
+	std::lock_guard<std::mutex> lock(mutex);
+	int seconds = (int)(histograms.size() / binCount);
+	if (seconds == 0) {
+		return false;
+	}
+	std::mutex totalsMutex;
+	cv::parallel_for_(cv::Range(0, seconds), [&](const cv::Range& range) {
+		std::vector<uint64_t> sums(binCount, 0);
+		for (int i = range.start; i < range.end; i++) {
+			const uint16_t* bins = &histograms[(size_t)i * binCount];
+			for (int b = 0; b < binCount; b++) {
+				sums[b] += bins[b];
+			}
+		}
+		std::lock_guard<std::mutex> totalsLock(totalsMutex);
+		for (int b = 0; b < binCount; b++) {
+			totals[b] += sums[b];
+		}
+	});
+	return true;
+}
+
+void VideoColorStats::run(std::string path, cv::Rect roi)
+{
+	traceThreadName("video stats");
+	cv::VideoCapture cap(path);
+	if (!cap.isOpened()) {
+		finished = true;
+		return;
+	}
+	double fps = cap.get(cv::CAP_PROP_FPS);
+	int framesPerSecond = fps >= 1 ? (int)(fps + 0.5) : 30;
+	double frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
+	totalSeconds = frameCount > 0 ? (int)ceil(frameCount / framesPerSecond) : 0;
+
+	double scale = std::min(1.0, sqrt(maxStatsPixels / (double)roi.area()));
+	cv::Size sampleSize(std::max(1, (int)(roi.width * scale)), std::max(1, (int)(roi.height * scale)));
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		samplePixels = sampleSize.area();
+	}
+
+	cv::Mat frame;
+	cv::Mat small;
+	cv::Mat hsv;
+	std::vector<uint16_t> bins(histHueBins * histSatBins);
+	for (int nr = 0; !stopping; nr++) {
+		// Only the first frame of every second is decoded completely.
+		if (nr % framesPerSecond != 0) {
+			if (!cap.grab()) {
+				break;
+			}
+			continue;
+		}
+		TRACE_SCOPE("stats frame");
+		if (!cap.read(frame)) {
+			break;
+		}
+		if ((roi & cv::Rect(0, 0, frame.cols, frame.rows)) != roi) {
+			break;
+		}
+		// Nearest neighbour keeps the colours of the video, no blends of marker and background.
+		cv::resize(frame(roi), small, sampleSize, 0, 0, cv::INTER_NEAREST);
+		cv::cvtColor(small, hsv, cv::COLOR_BGR2HSV);
+		std::fill(bins.begin(), bins.end(), 0);
+		for (int y = 0; y < hsv.rows; y++) {
+			const uchar* p = hsv.ptr<uchar>(y);
+			for (int x = 0; x < hsv.cols; x++, p += 3) {
+				if (p[2] >= statsMinValue) {
+					bins[p[0] * histHueBins / 180 * histSatBins + p[1] * histSatBins / 256]++;
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		histograms.insert(histograms.end(), bins.begin(), bins.end());
+	}
+	finished = true;
+}
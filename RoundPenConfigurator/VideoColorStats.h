@@ -0,0 +1,69 @@
+#ifndef VIDEOCOLORSTATS_H
+#define VIDEOCOLORSTATS_H
+
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HistogramModel.h"
+
+// Crops are shrunk to about this many pixels before they are counted.
+const int maxStatsPixels = 16384;
+
+// How much of the crop a colour covers over a whole video.
+struct ColorCoverage {
+	// Share of the scanned seconds in which the colour covers more than minShare of the crop.
+	float seconds;
+	// Largest share of the crop covered in any scanned second.
+	float maxShare;
+};
+
+// Colour summary of a whole video, built on a background thread while the
+// markers are configured. For every second of the video one frame is
+// cropped, shrunk to maxStatsPixels and counted into an H-S histogram with
+// the bins of HistogramModel. Picked colours can then be checked against
+// the whole recording instead of the one frame on screen.
+class VideoColorStats {
+public:
+	VideoColorStats();
+	// Stops the scan before returning.
+	~VideoColorStats();
+
+	// Scans the video at path inside roi, in full resolution pixels.
+	void start(const std::string& path, const cv::Rect& roi);
+	void stop();
+
+	// Seconds scanned so far and seconds of the video, 0 if unknown.
+	int scanned() const;
+	int total() const { return totalSeconds; }
+	bool done() const { return finished; }
+
+	// Coverage of the bins a marker with this model would be picked in by
+	// the default BackProjectionLut. False if nothing is scanned yet.
+	bool coverage(const HistogramModel& model, float minShare, ColorCoverage& out) const;
+	// Counts per H-S bin summed over all scanned seconds, split over the
+	// OpenCV worker threads. False if nothing is scanned yet.
+	bool binTotals(std::vector<uint64_t>& totals) const;
+
+private:
+	VideoColorStats(const VideoColorStats&);
+	VideoColorStats& operator=(const VideoColorStats&);
+
+	void run(std::string path, cv::Rect roi);
+
+	mutable std::mutex mutex;
+	// histHueBins * histSatBins counts per scanned second, hue major.
+	std::vector<uint16_t> histograms;
+	// Pixels counted per second, dark pixels included.
+	int samplePixels;
+	std::atomic<int> totalSeconds;
+	std::atomic<bool> stopping;
+	std::atomic<bool> finished;
+	std::thread worker;
+};
+
+#endif // VIDEOCOLORSTATS_H
@@ -0,0 +1,86 @@
+#include "ZoomView.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+#include "Trace.h"
+
+ZoomView::ZoomView() : fitScale(1), scale(1), origin(0, 0), dirty(true)
+{
+}
+
+void ZoomView::build(const cv::Mat& image, const cv::Size& viewSize)
+{
+	this->viewSize = viewSize;
+	fitScale = std::min(viewSize.width / (double)image.cols, viewSize.height / (double)image.rows);
+
+	// Only levels that are at least as large as the fitted view are needed.
+	levels.assign(1, image);
+	for (double levelScale = fitScale * 2; levelScale <= 1; levelScale *= 2) {
+		cv::Mat next;
+		cv::pyrDown(levels.back(), next);
+		levels.push_back(next);
+	}
+	reset();
+}
+
+void ZoomView::render(cv::Mat& dst) const
+{
+	if (dirty) {
+		TRACE_SCOPE("zoom warp");
+		// Smallest level that still has at least one pixel per view pixel.
+		int level = 0;
+		while (level + 1 < (int)levels.size() && scale * (1 << (level + 1)) <= 1) {
+			level++;
+		}
+		double levelFactor = 1 << level;
+		// Maps view to level coordinates, pixel centres to pixel centres.
+		cv::Mat viewToLevel = (cv::Mat_<double>(2, 3) <<
+			1 / (scale * levelFactor), 0, (origin.x + 0.5 / scale) / levelFactor - 0.5,
+			0, 1 / (scale * levelFactor), (origin.y + 0.5 / scale) / levelFactor - 0.5);
+		// Zoomed in, every image pixel should stay a sharp square.
+		int interpolation = scale >= 1 ? cv::INTER_NEAREST : cv::INTER_LINEAR;
+		cv::warpAffine(levels[level], rendered, viewToLevel, viewSize, interpolation | cv::WARP_INVERSE_MAP);
+		dirty = false;
+	}
+	rendered.copyTo(dst);
+}
+
+void ZoomView::zoomAt(const cv::Point& viewPos, double factor)
+{
+	cv::Point2d imagePos = origin + cv::Point2d(viewPos.x, viewPos.y) * (1 / scale);
+	scale = std::max(fitScale, std::min(maxZoomScale, scale * factor));
+	origin = imagePos - cv::Point2d(viewPos.x, viewPos.y) * (1 / scale);
+	clampOrigin();
+	dirty = true;
+}
+
+void ZoomView::pan(int dx, int dy)
+{
+	origin -= cv::Point2d(dx, dy) * (1 / scale);
+	clampOrigin();
+	dirty = true;
+}
+
+void ZoomView::reset()
+{
+	scale = fitScale;
+	origin = cv::Point2d(0, 0);
+	dirty = true;
+}
+
+cv::Point ZoomView::toImage(const cv::Point& viewPos) const
+{
+	int x = (int)std::floor(origin.x + (viewPos.x + 0.5) / scale);
+	int y = (int)std::floor(origin.y + (viewPos.y + 0.5) / scale);
+	return cv::Point(std::max(0, std::min(levels[0].cols - 1, x)), std::max(0, std::min(levels[0].rows - 1, y)));
+}
+
+void ZoomView::clampOrigin()
+{
+	double maxX = levels[0].cols - viewSize.width / scale;
+	double maxY = levels[0].rows - viewSize.height / scale;
+	origin.x = std::max(0.0, std::min(maxX, origin.x));
+	origin.y = std::max(0.0, std::min(maxY, origin.y));
+}
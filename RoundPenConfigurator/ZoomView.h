@@ -0,0 +1,53 @@
+#ifndef ZOOMVIEW_H
+#define ZOOMVIEW_H
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+// Largest zoom in view pixels per image pixel.
+const double maxZoomScale = 16;
+
+// Zoomable and pannable view of a full resolution image.
+// An image pyramid is built once, so every zoom level is rendered from the
+// level that is just larger than needed instead of from the full image.
+// The rendered view is kept until zoom or position change and copied
+// otherwise.
+class ZoomView {
+public:
+	ZoomView();
+
+	// Starts zoomed out so that the whole image fits into viewSize.
+	void build(const cv::Mat& image, const cv::Size& viewSize);
+
+	// Draws the visible part into dst, which must have the view size.
+	void render(cv::Mat& dst) const;
+
+	// Multiplies the zoom by factor, keeping the image pixel under viewPos in place.
+	void zoomAt(const cv::Point& viewPos, double factor);
+	// Moves the image by dx and dy view pixels.
+	void pan(int dx, int dy);
+	// Back to the whole image.
+	void reset();
+
+	// Full resolution pixel shown at viewPos.
+	cv::Point toImage(const cv::Point& viewPos) const;
+	// View pixels per image pixel.
+	double getScale() const { return scale; }
+	cv::Size getViewSize() const { return viewSize; }
+
+private:
+	void clampOrigin();
+
+	// levels[0] is the image, every further level half the size of the one before.
+	std::vector<cv::Mat> levels;
+	cv::Size viewSize;
+	double fitScale;
+	double scale;
+	// Image coordinates of the top left corner of the view.
+	cv::Point2d origin;
+
+	mutable cv::Mat rendered;
+	mutable bool dirty;
+};
+
+#endif // ZOOMVIEW_H
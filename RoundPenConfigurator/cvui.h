@@ -61,6 +61,8 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <string>
+#include <unordered_map>
 #include <stdarg.h>
 
 #include <opencv2/imgproc/imgproc.hpp>
@@ -69,6 +71,17 @@
 
 namespace cvui
 {
+/**
+ Handle of a window, as returned by `cvui::handle()`. The functions that take a handle
+ instead of a window name access the window's context by index, without comparing names.
+ Handles stay valid for the lifetime of the program. `index` is `-1` for an unknown window.
+
+ \sa handle()
+*/
+struct WindowHandle {
+	int index;
+};
+
 /**
  Initializes cvui. You must provide the name of the window where
  components will be added. It is also possible to tell cvui to handle
@@ -121,6 +134,57 @@ void init(const cv::String theWindowNames[], size_t theHowManyWindows, int theDe
 */
 void watch(const cv::String& theWindowName, bool theCreateNamedWindow = true);
 
+/**
+ Initializes cvui without an OpenCV window, e.g. on machines without a display.
+ Components are rendered into `cv::Mat` as usual, but nothing calls `cv::namedWindow()`,
+ `cv::setMouseCallback()`, `cv::waitKey()` or `cv::imshow()` for this window. Input comes from
+ `cvui::injectMouse()` and `cvui::injectKey()`, e.g. from a recording.
+
+ \param theWindowName name of the headless window where the components will be added.
+
+ \sa watchHeadless()
+*/
+void initHeadless(const cv::String& theWindowName);
+
+/**
+ Track UI interactions of a headless window, i.e. one without an OpenCV window.
+ `cvui::initHeadless()` calls it for its window.
+
+ \param theWindowName name of the headless window whose UI interactions will be tracked.
+
+ \sa initHeadless()
+*/
+void watchHeadless(const cv::String& theWindowName);
+
+/**
+ Hand a mouse event to a window as if it came from OpenCV's mouse callback.
+ Like OpenCV events, it should arrive before the component calls of the frame it belongs to.
+
+ \param theWindowName name of the window.
+ \param theEvent OpenCV mouse event, e.g. `cv::EVENT_LBUTTONDOWN`.
+ \param theX x coordinate of the mouse in the window.
+ \param theY y coordinate of the mouse in the window.
+ \param theFlags OpenCV mouse event flags.
+*/
+void injectMouse(const cv::String& theWindowName, int theEvent, int theX, int theY, int theFlags = 0);
+
+/**
+ Hand a mouse event to the window of a handle, see `cvui::injectMouse(const cv::String&, int, int, int, int)`.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+
+ \sa handle()
+*/
+void injectMouse(WindowHandle theHandle, int theEvent, int theX, int theY, int theFlags = 0);
+
+/**
+ Set the key returned by `cvui::lastKeyPressed()` and used for keyboard shortcuts, as if
+ `cv::waitKey()` had returned it. `-1` means no key.
+
+ \param theKey key code as returned by `cv::waitKey()`.
+*/
+void injectKey(int theKey);
+
 /**
  Inform cvui that all subsequent component calls belong to a window in particular.
  When using cvui with multiple OpenCV windows, you must call cvui component calls
@@ -182,6 +246,29 @@ void watch(const cv::String& theWindowName, bool theCreateNamedWindow = true);
 */
 void context(const cv::String& theWindowName);
 
+/**
+ Return the handle of a window. A handle can be used instead of the window name in
+ `cvui::context()`, `cvui::update()`, `cvui::imshow()`, `cvui::mouse()` and `cvui::injectMouse()`,
+ which then access the window's context by index instead of comparing names.
+
+ \param theWindowName name of a window already given to `cvui::init()`, `cvui::watch()` or `cvui::watchHeadless()`.
+ \return the handle of the window, its `index` is `-1` if no such window is known.
+
+ \sa context()
+ \sa update()
+*/
+WindowHandle handle(const cv::String& theWindowName);
+
+/**
+ Inform cvui that all subsequent component calls belong to a window in particular.
+ Same as `cvui::context(const cv::String&)`, but without looking up the window name.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+
+ \sa handle()
+*/
+void context(WindowHandle theHandle);
+
 /**
  Display an image in the specified window and update the internal structures of cvui.
  This function can be used as a replacement for `cv::imshow()`. If you want to use
@@ -201,6 +288,17 @@ void context(const cv::String& theWindowName);
 */
 void imshow(const cv::String& theWindowName, cv::InputArray theFrame);
 
+/**
+ Display an image in the window of a handle, see `cvui::imshow(const cv::String&, cv::InputArray)`.
+ Like `cvui::update(WindowHandle)`, the window becomes the current context.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+ \param theFrame image, i.e. `cv::Mat`, to be shown in the window.
+
+ \sa handle()
+*/
+void imshow(WindowHandle theHandle, cv::InputArray theFrame);
+
 /**
  Return the last key that was pressed. This function will only
  work if a value greater than zero was passed to `cvui::init()`
@@ -218,6 +316,15 @@ int lastKeyPressed();
 */
 cv::Point mouse(const cv::String& theWindowName = "");
 
+/**
+ Return the last position of the mouse in the window of a handle.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+
+ \sa handle()
+*/
+cv::Point mouse(WindowHandle theHandle);
+
 /**
  Query the mouse for events, e.g. "is any button down now?". Available queries are:
  
@@ -261,6 +368,16 @@ bool mouse(int theQuery);
 */
 bool mouse(const cv::String& theWindowName, int theQuery);
 
+/**
+ Query the mouse for events in the window of a handle, see `cvui::mouse(const cv::String&, int)`.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+ \param theQuery integer describing the intended mouse query. Available queries are `cvui::DOWN`, `cvui::UP`, `cvui::CLICK`, and `cvui::IS_DOWN`.
+
+ \sa handle()
+*/
+bool mouse(WindowHandle theHandle, int theQuery);
+
 /**
  Query the mouse for events in a particular button. This function behave exactly like `cvui::mouse(int theQuery)`,
  with the difference that queries are targeted at a particular mouse button instead.
@@ -285,6 +402,18 @@ bool mouse(int theButton, int theQuery);
 */
 bool mouse(const cv::String& theWindowName, int theButton, int theQuery);
 
+/**
+ Query the mouse for events in a particular button in the window of a handle,
+ see `cvui::mouse(const cv::String&, int, int)`.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+ \param theButton integer describing the mouse button to be queried. Possible values are `cvui::LEFT_BUTTON`, `cvui::MIDDLE_BUTTON` and `cvui::LEFT_BUTTON`.
+ \param theQuery integer describing the intended mouse query. Available queries are `cvui::DOWN`, `cvui::UP`, `cvui::CLICK`, and `cvui::IS_DOWN`.
+
+ \sa handle()
+*/
+bool mouse(WindowHandle theHandle, int theButton, int theQuery);
+
 /**
  Display a button. The size of the button will be automatically adjusted to
  properly house the label content.
@@ -1039,6 +1168,29 @@ void sparkline(std::vector<double>& theValues, int theWidth, int theHeight, unsi
 */
 void update(const cv::String& theWindowName = "");
 
+/**
+ Update the library internal things of the window of a handle, see `cvui::update(const cv::String&)`.
+ The window becomes the current context, so the component calls of the next frame find
+ it without a lookup.
+
+ \param theHandle handle of the window, as returned by `cvui::handle()`.
+
+ \sa handle()
+*/
+void update(WindowHandle theHandle);
+
+/**
+ Enable or disable the retained mode. In retained mode cvui keeps what it measured
+ for a frame, e.g. the size of every label, and reuses it in the next frames as long
+ as the inputs of the component stay the same. Only components whose text or font
+ scale changed are measured again, so the cost of a frame no longer grows with the
+ number of unchanged components. Measurements unused for a while are dropped.
+ The retained mode is disabled by default.
+
+ \param theEnabled if the retained mode should be used.
+*/
+void retained(bool theEnabled);
+
 // Internally used to handle mouse events
 void handleMouse(int theEvent, int theX, int theY, int theFlags, void* theData);
 
@@ -1170,20 +1322,34 @@ typedef struct {
 typedef struct {
 	cv::String windowName;       // name of the window related to this context.
 	cvui_mouse_t mouse;          // the mouse cursor related to this context.
+	bool headless;               // if there is no OpenCV window, see cvui::initHeadless().
 } cvui_context_t;
 
 // Internal namespace with all code that is shared among components/functions.
 // You should probably not be using anything from here.
 namespace internal
 {
-	static cv::String gDefaultContext;
-	static cv::String gCurrentContext;
-	static std::map<cv::String, cvui_context_t> gContexts; // indexed by the window name.
+	static const int gMaxContexts = 32;
+	static int gDefaultContext = -1; // index of the default context, -1 if none.
+	static int gCurrentContext = -1; // index of the active context, -1 if none.
+	static cvui_context_t gContexts[gMaxContexts]; // one per window, never moved, so their addresses can be handed to OpenCV.
+	static int gContextCount = 0;
 	static char gBuffer[1024];
 	static int gLastKeyPressed; // TODO: collect it per window
 	static int gDelayWaitKey;
 	static cvui_block_t gScreen;
 
+	// Text size measured in retained mode.
+	typedef struct {
+		cv::Size size;
+		unsigned int lastUsed;  // value of gFrame when the size was last asked for.
+	} cvui_text_size_t;
+
+	static bool gRetained = false;
+	static unsigned int gFrame = 0; // counts calls of update().
+	static const unsigned int gTextSizeMaxAge = 64; // frames a text size is kept without being used.
+	static std::vector<std::pair<double, std::unordered_map<std::string, cvui_text_size_t> > > gTextSizes; // one table per font scale.
+
 	struct TrackbarParams {
 		long double min;
 		long double max;
@@ -1209,7 +1375,14 @@ namespace internal
 	bool isMouseButton(cvui_mouse_btn_t& theButton, int theQuery);
 	void resetMouseButton(cvui_mouse_btn_t& theButton);
 	void init(const cv::String& theWindowName, int theDelayWaitKey);
-	cvui_context_t& getContext(const cv::String& theWindowName = "");
+	int findContext(const cv::String& theWindowName, bool theCreate);
+	WindowHandle currentHandle();
+	WindowHandle findHandle(const cv::String& theWindowName);
+	cvui_context_t& getContext(WindowHandle theHandle);
+	cvui_context_t& getContext();
+	void updateContext(cvui_context_t& theContext);
+	cv::Size textSize(const std::string& theText, double theFontScale);
+	void evictTextSizes();
 	bool bitsetHas(unsigned int theBitset, unsigned int theValue);
 	void error(int theId, std::string theMessage);
 	void updateLayoutFlow(cvui_block_t& theBlock, cv::Size theSize);
@@ -1372,30 +1545,115 @@ namespace internal
 	}
 
 	void init(const cv::String& theWindowName, int theDelayWaitKey) {
-		internal::gDefaultContext = theWindowName;
-		internal::gCurrentContext = theWindowName;
+		internal::gDefaultContext = findContext(theWindowName, true);
+		internal::gCurrentContext = internal::gDefaultContext;
 		internal::gDelayWaitKey = theDelayWaitKey;
 		internal::gLastKeyPressed = -1;
 	}
 
-	cvui_context_t& getContext(const cv::String& theWindowName) {
-		if (!theWindowName.empty()) {
-			// Get context in particular
-			return internal::gContexts[theWindowName];
+	int findContext(const cv::String& theWindowName, bool theCreate) {
+		for (int i = 0; i < internal::gContextCount; i++) {
+			if (internal::gContexts[i].windowName == theWindowName) {
+				return i;
+			}
+		}
+
+		if (!theCreate) {
+			return -1;
+		}
 
-		} else if (!internal::gCurrentContext.empty()) {
-			// No window provided, return currently active context.
-			return internal::gContexts[internal::gCurrentContext];
+		if (internal::gContextCount == internal::gMaxContexts) {
+			internal::error(7, "Too many windows. Increase gMaxContexts.");
+		}
 
-		} else if (!internal::gDefaultContext.empty()) {
+		cvui_context_t& aContext = internal::gContexts[internal::gContextCount];
+		aContext.windowName = theWindowName;
+		aContext.mouse = cvui_mouse_t();
+		aContext.headless = false;
+
+		return internal::gContextCount++;
+	}
+
+	WindowHandle currentHandle() {
+		WindowHandle aHandle;
+
+		if (internal::gCurrentContext >= 0) {
+			// Return currently active context.
+			aHandle.index = internal::gCurrentContext;
+
+		} else if (internal::gDefaultContext >= 0) {
 			// We have no active context, so let's use the default one.
-			return internal::gContexts[internal::gDefaultContext];
+			aHandle.index = internal::gDefaultContext;
 
 		} else {
 			// Apparently we have no window at all! <o>
 			// This should not happen. Probably cvui::init() was never called.
 			internal::error(5, "Unable to read context. Did you forget to call cvui::init()?");
-			return internal::gContexts["first"]; // return to make the compiler happy.
+			aHandle.index = 0;
+		}
+
+		return aHandle;
+	}
+
+	WindowHandle findHandle(const cv::String& theWindowName) {
+		if (theWindowName.empty()) {
+			return currentHandle();
+		}
+
+		// Get context in particular, the only name comparison of a call.
+		WindowHandle aHandle;
+		aHandle.index = findContext(theWindowName, true);
+		return aHandle;
+	}
+
+	cvui_context_t& getContext(WindowHandle theHandle) {
+		if (theHandle.index < 0 || theHandle.index >= internal::gContextCount) {
+			internal::error(8, "Invalid window handle. Use the value returned by cvui::handle().");
+		}
+
+		return internal::gContexts[theHandle.index];
+	}
+
+	cvui_context_t& getContext() {
+		return internal::gContexts[currentHandle().index];
+	}
+
+	cv::Size textSize(const std::string& theText, double theFontScale) {
+		if (!internal::gRetained) {
+			return cv::getTextSize(theText, cv::FONT_HERSHEY_SIMPLEX, theFontScale, 1, nullptr);
+		}
+
+		size_t i = 0;
+		while (i < internal::gTextSizes.size() && internal::gTextSizes[i].first != theFontScale) {
+			i++;
+		}
+		if (i == internal::gTextSizes.size()) {
+			internal::gTextSizes.push_back(std::make_pair(theFontScale, std::unordered_map<std::string, cvui_text_size_t>()));
+		}
+
+		std::unordered_map<std::string, cvui_text_size_t>& aSizes = internal::gTextSizes[i].second;
+		std::unordered_map<std::string, cvui_text_size_t>::iterator aFound = aSizes.find(theText);
+		if (aFound == aSizes.end()) {
+			cvui_text_size_t aEntry;
+			aEntry.size = cv::getTextSize(theText, cv::FONT_HERSHEY_SIMPLEX, theFontScale, 1, nullptr);
+			aFound = aSizes.insert(std::make_pair(theText, aEntry)).first;
+		}
+		aFound->second.lastUsed = internal::gFrame;
+
+		return aFound->second.size;
+	}
+
+	void evictTextSizes() {
+		// Texts that change every frame, e.g. a counter, would otherwise pile up.
+		for (size_t i = 0; i < internal::gTextSizes.size(); i++) {
+			std::unordered_map<std::string, cvui_text_size_t>& aSizes = internal::gTextSizes[i].second;
+			for (std::unordered_map<std::string, cvui_text_size_t>::iterator aIt = aSizes.begin(); aIt != aSizes.end(); ) {
+				if (internal::gFrame - aIt->second.lastUsed > internal::gTextSizeMaxAge) {
+					aIt = aSizes.erase(aIt);
+				} else {
+					++aIt;
+				}
+			}
 		}
 	}
 
@@ -1405,7 +1663,9 @@ namespace internal
 
 	void error(int theId, std::string theMessage) {
 		std::cout << "[CVUI] Fatal error (code " << theId << "): " << theMessage << "\n";
-		cv::waitKey(100000);
+		if (gDefaultContext < 0 || !gContexts[gDefaultContext].headless) {
+			cv::waitKey(100000);
+		}
 		exit(-1);
 	}
 
@@ -1638,7 +1898,7 @@ namespace internal
 
 	bool button(cvui_block_t& theBlock, int theX, int theY, int theWidth, int theHeight, const cv::String& theLabel, bool theUpdateLayout) {
 		// Calculate the space that the label will fill
-		cv::Size aTextSize = getTextSize(theLabel, cv::FONT_HERSHEY_SIMPLEX, 0.4, 1, nullptr);
+		cv::Size aTextSize = internal::textSize(theLabel, 0.4);
 
 		// Make the button bit enough to house the label
 		cv::Rect aRect(theX, theY, theWidth, theHeight);
@@ -1672,7 +1932,7 @@ namespace internal
 
 	bool button(cvui_block_t& theBlock, int theX, int theY, const cv::String& theLabel) {
 		// Calculate the space that the label will fill
-		cv::Size aTextSize = getTextSize(theLabel, cv::FONT_HERSHEY_SIMPLEX, 0.4, 1, nullptr);
+		cv::Size aTextSize = internal::textSize(theLabel, 0.4);
 
 		// Create a button based on the size of the text
 		return internal::button(theBlock, theX, theY, aTextSize.width + 30, aTextSize.height + 18, theLabel, true);
@@ -1713,7 +1973,7 @@ namespace internal
 	bool checkbox(cvui_block_t& theBlock, int theX, int theY, const cv::String& theLabel, bool *theState, unsigned int theColor) {
 		cvui_mouse_t& aMouse = internal::getContext().mouse;
 		cv::Rect aRect(theX, theY, 15, 15);
-		cv::Size aTextSize = getTextSize(theLabel, cv::FONT_HERSHEY_SIMPLEX, 0.4, 1, nullptr);
+		cv::Size aTextSize = internal::textSize(theLabel, 0.4);
 		cv::Rect aHitArea(theX, theY, aRect.width + aTextSize.width + 6, aRect.height);
 		bool aMouseIsOver = aHitArea.contains(aMouse.position);
 
@@ -1741,7 +2001,7 @@ namespace internal
 	}
 
 	void text(cvui_block_t& theBlock, int theX, int theY, const cv::String& theText, double theFontScale, unsigned int theColor, bool theUpdateLayout) {
-		cv::Size aTextSize = cv::getTextSize(theText, cv::FONT_HERSHEY_SIMPLEX, theFontScale, 1, nullptr);
+		cv::Size aTextSize = internal::textSize(theText, theFontScale);
 		cv::Point aPos(theX, theY + aTextSize.height);
 
 		render::text(theBlock, theText, aPos, theFontScale, theColor);
@@ -1892,7 +2152,7 @@ namespace render
 
 		if (theText != "") {
 			cv::putText(theBlock.where, theText, thePosition, cv::FONT_HERSHEY_SIMPLEX, aFontSize, aColor, 1, CVUI_ANTIALISED);
-			aSize = cv::getTextSize(theText, cv::FONT_HERSHEY_SIMPLEX, aFontSize, 1, nullptr);
+			aSize = internal::textSize(theText, aFontSize);
 		}
 
 		return aSize.width;
@@ -1901,7 +2161,7 @@ namespace render
 	int putTextCentered(cvui_block_t& theBlock, const cv::Point & position, const std::string &text) {
 		double aFontScale = 0.3;
 
-		auto size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, aFontScale, 1, nullptr);
+		auto size = internal::textSize(text, aFontScale);
 		cv::Point positionDecentered(position.x - size.width / 2, position.y);
 		cv::putText(theBlock.where, text, positionDecentered, cv::FONT_HERSHEY_SIMPLEX, aFontScale, cv::Scalar(0xCE, 0xCE, 0xCE), 1, CVUI_ANTIALISED);
 
@@ -1942,7 +2202,7 @@ namespace render
 		cv::rectangle(theBlock.where, theShape, cv::Scalar(0x29, 0x29, 0x29), CVUI_FILLED); // fill
 		cv::rectangle(theBlock.where, theShape, cv::Scalar(0x45, 0x45, 0x45)); // border
 
-		cv::Size aTextSize = getTextSize(theValue, cv::FONT_HERSHEY_SIMPLEX, 0.4, 1, nullptr);
+		cv::Size aTextSize = internal::textSize(theValue, 0.4);
 
 		cv::Point aPos(theShape.x + theShape.width / 2 - aTextSize.width / 2, theShape.y + aTextSize.height / 2 + theShape.height / 2);
 		cv::putText(theBlock.where, theValue, aPos, cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(0xCE, 0xCE, 0xCE), 1, CVUI_ANTIALISED);
@@ -2187,23 +2447,77 @@ void watch(const cv::String& theWindowName, bool theCreateNamedWindow) {
 	aContex.windowName = theWindowName;
 	aContex.mouse.position.x = 0;
 	aContex.mouse.position.y = 0;
+	aContex.headless = false;
 	
 	internal::resetMouseButton(aContex.mouse.anyButton);
 	internal::resetMouseButton(aContex.mouse.buttons[RIGHT_BUTTON]);
 	internal::resetMouseButton(aContex.mouse.buttons[MIDDLE_BUTTON]);
 	internal::resetMouseButton(aContex.mouse.buttons[LEFT_BUTTON]);
 
-	internal::gContexts[theWindowName] = aContex;
-	cv::setMouseCallback(theWindowName, handleMouse, &internal::gContexts[theWindowName]);
+	cvui_context_t& aSlot = internal::gContexts[internal::findContext(theWindowName, true)];
+	aSlot = aContex;
+	cv::setMouseCallback(theWindowName, handleMouse, &aSlot);
+}
+
+void initHeadless(const cv::String& theWindowName) {
+	internal::init(theWindowName, -1);
+	watchHeadless(theWindowName);
+}
+
+void watchHeadless(const cv::String& theWindowName) {
+	cvui_context_t aContex;
+
+	aContex.windowName = theWindowName;
+	aContex.mouse.position.x = 0;
+	aContex.mouse.position.y = 0;
+	aContex.headless = true;
+
+	internal::resetMouseButton(aContex.mouse.anyButton);
+	internal::resetMouseButton(aContex.mouse.buttons[RIGHT_BUTTON]);
+	internal::resetMouseButton(aContex.mouse.buttons[MIDDLE_BUTTON]);
+	internal::resetMouseButton(aContex.mouse.buttons[LEFT_BUTTON]);
+
+	internal::gContexts[internal::findContext(theWindowName, true)] = aContex;
+}
+
+void injectMouse(const cv::String& theWindowName, int theEvent, int theX, int theY, int theFlags) {
+	injectMouse(internal::findHandle(theWindowName), theEvent, theX, theY, theFlags);
+}
+
+void injectMouse(WindowHandle theHandle, int theEvent, int theX, int theY, int theFlags) {
+	handleMouse(theEvent, theX, theY, theFlags, &internal::getContext(theHandle));
+}
+
+void injectKey(int theKey) {
+	internal::gLastKeyPressed = theKey;
 }
 
 void context(const cv::String& theWindowName) {
-	internal::gCurrentContext = theWindowName;
+	internal::gCurrentContext = internal::findContext(theWindowName, true);
+}
+
+WindowHandle handle(const cv::String& theWindowName) {
+	WindowHandle aHandle;
+	aHandle.index = internal::findContext(theWindowName, false);
+	return aHandle;
+}
+
+void context(WindowHandle theHandle) {
+	internal::getContext(theHandle);
+	internal::gCurrentContext = theHandle.index;
 }
 
 void imshow(const cv::String& theWindowName, cv::InputArray theFrame) {
-	cvui::update(theWindowName);
-	cv::imshow(theWindowName, theFrame);
+	imshow(internal::findHandle(theWindowName), theFrame);
+}
+
+void imshow(WindowHandle theHandle, cv::InputArray theFrame) {
+	cvui::update(theHandle);
+
+	cvui_context_t& aContext = internal::getContext(theHandle);
+	if (!aContext.headless) {
+		cv::imshow(aContext.windowName, theFrame);
+	}
 }
 
 int lastKeyPressed() {
@@ -2211,30 +2525,42 @@ int lastKeyPressed() {
 }
 
 cv::Point mouse(const cv::String& theWindowName) {
-	return internal::getContext(theWindowName).mouse.position;
+	return mouse(internal::findHandle(theWindowName));
+}
+
+cv::Point mouse(WindowHandle theHandle) {
+	return internal::getContext(theHandle).mouse.position;
 }
 
 bool mouse(int theQuery) {
-	return mouse("", theQuery);
+	return mouse(internal::currentHandle(), theQuery);
 }
 
 bool mouse(const cv::String& theWindowName, int theQuery) {
-	cvui_mouse_btn_t& aButton = internal::getContext(theWindowName).mouse.anyButton;
+	return mouse(internal::findHandle(theWindowName), theQuery);
+}
+
+bool mouse(WindowHandle theHandle, int theQuery) {
+	cvui_mouse_btn_t& aButton = internal::getContext(theHandle).mouse.anyButton;
 	bool aRet = internal::isMouseButton(aButton, theQuery);
 
 	return aRet;
 }
 
 bool mouse(int theButton, int theQuery) {
-	return mouse("", theButton, theQuery);
+	return mouse(internal::currentHandle(), theButton, theQuery);
 }
 
 bool mouse(const cv::String& theWindowName, int theButton, int theQuery) {
+	return mouse(internal::findHandle(theWindowName), theButton, theQuery);
+}
+
+bool mouse(WindowHandle theHandle, int theButton, int theQuery) {
 	if (theButton != RIGHT_BUTTON && theButton != MIDDLE_BUTTON && theButton != LEFT_BUTTON) {
 		internal::error(6, "Invalid mouse button. Are you using one of the available: cvui::{RIGHT,MIDDLE,LEFT}_BUTTON ?");
 	}
 
-	cvui_mouse_btn_t& aButton = internal::getContext(theWindowName).mouse.buttons[theButton];
+	cvui_mouse_btn_t& aButton = internal::getContext(theHandle).mouse.buttons[theButton];
 	bool aRet = internal::isMouseButton(aButton, theQuery);
 
 	return aRet;
@@ -2432,28 +2758,52 @@ void sparkline(std::vector<double>& theValues, int theWidth, int theHeight, unsi
 }
 
 void update(const cv::String& theWindowName) {
-	cvui_context_t& aContext = internal::getContext(theWindowName);
+	update(internal::findHandle(theWindowName));
+}
+
+void update(WindowHandle theHandle) {
+	internal::updateContext(internal::getContext(theHandle));
+	internal::gCurrentContext = theHandle.index;
+}
 
-	aContext.mouse.anyButton.justReleased = false;
-	aContext.mouse.anyButton.justPressed = false;
+void retained(bool theEnabled) {
+	internal::gRetained = theEnabled;
 
-	for (int i = cvui::LEFT_BUTTON; i <= cvui::RIGHT_BUTTON; i++) {
-		aContext.mouse.buttons[i].justReleased = false;
-		aContext.mouse.buttons[i].justPressed = false;
+	if (!theEnabled) {
+		internal::gTextSizes.clear();
 	}
+}
+
+namespace internal
+{
+	void updateContext(cvui_context_t& aContext) {
+		aContext.mouse.anyButton.justReleased = false;
+		aContext.mouse.anyButton.justPressed = false;
+
+		for (int i = cvui::LEFT_BUTTON; i <= cvui::RIGHT_BUTTON; i++) {
+			aContext.mouse.buttons[i].justReleased = false;
+			aContext.mouse.buttons[i].justPressed = false;
+		}
 	
-	internal::resetRenderingBuffer(internal::gScreen);
+		internal::resetRenderingBuffer(internal::gScreen);
 
-	// If we were told to keep track of the keyboard shortcuts, we
-	// proceed to handle opencv event queue.
-	if (internal::gDelayWaitKey > 0) {
-		internal::gLastKeyPressed = cv::waitKey(internal::gDelayWaitKey);
-	}
+		internal::gFrame++;
+		if (internal::gRetained && internal::gFrame % internal::gTextSizeMaxAge == 0) {
+			internal::evictTextSizes();
+		}
 
-	if (!internal::blockStackEmpty()) {
-		internal::error(2, "Calling update() before finishing all begin*()/end*() calls. Did you forget to call a begin*() or an end*()? Check if every begin*() has an appropriate end*() call before you call update().");
+		// A headless window gets its events injected instead of from the opencv event queue.
+		if (!aContext.headless && internal::gDelayWaitKey > 0) {
+			// If we were told to keep track of the keyboard shortcuts, we
+			// proceed to handle opencv event queue.
+			internal::gLastKeyPressed = cv::waitKey(internal::gDelayWaitKey);
+		}
+
+		if (!internal::blockStackEmpty()) {
+			internal::error(2, "Calling update() before finishing all begin*()/end*() calls. Did you forget to call a begin*() or an end*()? Check if every begin*() has an appropriate end*() call before you call update().");
+		}
 	}
-}
+} // namespace internal
 
 void handleMouse(int theEvent, int theX, int theY, int theFlags, void* theData) {
 	int aButtons[3] = { cvui::LEFT_BUTTON, cvui::MIDDLE_BUTTON, cvui::RIGHT_BUTTON };
@@ -0,0 +1,277 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+#include "../RoundPenConfigurator/MarkerConfig.h"
+#include "../RoundPenConfigurator/Trace.h"
+#include "../RoundPenSynth/GroundTruth.h"
+#include "../RoundPenTracker/ConfigWatcher.h"
+#include "../RoundPenTracker/MarkerDetector.h"
+
+using namespace std;
+
+// Detections and localisation errors of one marker over the whole video.
+struct MarkerScore {
+	MarkerScore() : truePositives(0), falsePositives(0), falseNegatives(0), errorSum(0), errorMax(0) {}
+
+	void add(const MarkerScore& other)
+	{
+		truePositives += other.truePositives;
+		falsePositives += other.falsePositives;
+		falseNegatives += other.falseNegatives;
+		errorSum += other.errorSum;
+		errorMax = max(errorMax, other.errorMax);
+	}
+	double precision() const { return truePositives + falsePositives > 0 ? truePositives / (double)(truePositives + falsePositives) : 0; }
+	double recall() const { return truePositives + falseNegatives > 0 ? truePositives / (double)(truePositives + falseNegatives) : 0; }
+	double meanError() const { return truePositives > 0 ? errorSum / truePositives : 0; }
+
+	long truePositives;
+	long falsePositives;
+	long falseNegatives;
+	double errorSum;
+	double errorMax;
+};
+
+static size_t peakResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return (size_t)usage.ru_maxrss;
+#else
+	// Kilobytes on Linux.
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static string jsonString(const string& text)
+{
+	string quoted = "\"";
+	for (size_t i = 0; i < text.size(); i++) {
+		char c = text[i];
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+			quoted += c;
+		}
+		else if ((unsigned char)c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+			quoted += escaped;
+		}
+		else {
+			quoted += c;
+		}
+	}
+	return quoted + "\"";
+}
+
+static void writeScore(ostream& out, const MarkerScore& score)
+{
+	out << "\"precision\":" << score.precision() << ",\"recall\":" << score.recall()
+		<< ",\"mean_error_px\":" << score.meanError() << ",\"max_error_px\":" << score.errorMax
+		<< ",\"true_positives\":" << score.truePositives << ",\"false_positives\":" << score.falsePositives
+		<< ",\"false_negatives\":" << score.falseNegatives;
+}
+
+static void usage()
+{
+	cerr << "Usage: RoundPenEval <video> <truth.csv> [markers.bin] [--scale=1] [--step=1] [--search=0]" << endl
+		<< "       [--classifier=lut|distance] [--report=eval.json] [--trace[=trace.json]]" << endl;
+}
+
+// Runs the tracker detection over a video with known marker positions, e.g.
+// from RoundPenSynth, and reports accuracy next to throughput and memory.
+// A detection is correct if it lies within the radius of its marker.
+int main(int argc, char** argv)
+{
+	traceFromArgs(argc, argv);
+	traceThreadName("main");
+
+	DetectorSettings settings;
+	const char* reportPath = "eval.json";
+	vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		char* end = NULL;
+		if (strncmp(arg, "--", 2) != 0) {
+			args.push_back(arg);
+		}
+		else if (strncmp(arg, "--scale=", 8) == 0) {
+			settings.scale = strtod(arg + 8, &end);
+			if (*end != '\0' || settings.scale <= 0 || settings.scale > 1) {
+				usage();
+				return -1;
+			}
+		}
+		else if (strncmp(arg, "--step=", 7) == 0) {
+			settings.step = (int)strtol(arg + 7, &end, 10);
+			if (*end != '\0' || settings.step < 1) {
+				usage();
+				return -1;
+			}
+		}
+		else if (strncmp(arg, "--search=", 9) == 0) {
+			settings.searchMargin = (int)strtol(arg + 9, &end, 10);
+			if (*end != '\0' || settings.searchMargin < 0) {
+				usage();
+				return -1;
+			}
+		}
+		else if (strcmp(arg, "--classifier=lut") == 0 || strcmp(arg, "--classifier=distance") == 0) {
+			settings.useLut = strcmp(arg, "--classifier=lut") == 0;
+		}
+		else if (strncmp(arg, "--report=", 9) == 0) {
+			reportPath = arg + 9;
+		}
+		else if (strncmp(arg, "--trace", 7) != 0) {
+			usage();
+			return -1;
+		}
+	}
+	if (args.size() < 2) {
+		usage();
+		return -1;
+	}
+	const char* configPath = args.size() > 2 ? args[2] : "markers.bin";
+
+	GroundTruth truth;
+	if (!readGroundTruth(args[1], truth)) {
+		cerr << "Error reading " << args[1] << endl;
+		return -1;
+	}
+	// Loaded like the tracker does, with the lookup table precomputed in the file.
+	TrackerTables tables;
+	if (!loadTrackerTables(configPath, tables)) {
+		cerr << "Error reading " << configPath << endl;
+		return -1;
+	}
+	tables.generation = 1;
+	const MarkerConfig& config = tables.config;
+
+	cv::VideoCapture cap(args[0]);
+	if (!cap.isOpened()) {
+		cerr << "Error opening video" << endl;
+		return -1;
+	}
+
+	MarkerDetector detector(settings);
+	vector<MarkerScore> scores(config.names.size());
+	vector<DetectedMarker> found;
+	const vector<GroundTruthMarker> none;
+	cv::Mat frame;
+	int frames = 0;
+	int64 detectTicks = 0;
+	int64 start = cv::getTickCount();
+	while (true) {
+		TRACE_SCOPE("frame");
+		{
+			TRACE_SCOPE("decode");
+			if (!cap.read(frame)) {
+				break;
+			}
+		}
+		int64 detectStart = cv::getTickCount();
+		detector.detect(frame, tables, found);
+		detectTicks += cv::getTickCount() - detectStart;
+
+		// The detector finds at most one blob per marker.
+		const vector<GroundTruthMarker>& expected = frames < (int)truth.size() ? truth[frames] : none;
+		vector<bool> matched(found.size(), false);
+		for (size_t i = 0; i < expected.size(); i++) {
+			const GroundTruthMarker& t = expected[i];
+			if (t.marker < 0 || t.marker >= (int)scores.size()) {
+				continue;
+			}
+			MarkerScore& score = scores[t.marker];
+			size_t j = 0;
+			while (j < found.size() && found[j].marker != t.marker) {
+				j++;
+			}
+			if (j == found.size()) {
+				score.falseNegatives++;
+				continue;
+			}
+			double error = cv::norm(found[j].center - t.center);
+			if (error <= t.radius) {
+				matched[j] = true;
+				score.truePositives++;
+				score.errorSum += error;
+				score.errorMax = max(score.errorMax, error);
+			}
+			else {
+				score.falseNegatives++;
+			}
+		}
+		for (size_t j = 0; j < found.size(); j++) {
+			if (!matched[j]) {
+				scores[found[j].marker].falsePositives++;
+			}
+		}
+		frames++;
+	}
+	double totalSeconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+	double detectSeconds = detectTicks / cv::getTickFrequency();
+	double peakMb = peakResidentBytes() / (1024.0 * 1024.0);
+
+	MarkerScore total;
+	printf("%-20s  %9s  %6s  %10s  %9s\n", "Marker", "precision", "recall", "mean error", "max error");
+	for (size_t i = 0; i < scores.size(); i++) {
+		const MarkerScore& s = scores[i];
+		printf("%-20s  %9.3f  %6.3f  %10.2f  %9.2f\n", config.names[i].c_str(), s.precision(), s.recall(), s.meanError(), s.errorMax);
+		total.add(s);
+	}
+	printf("%-20s  %9.3f  %6.3f  %10.2f  %9.2f\n", "All", total.precision(), total.recall(), total.meanError(), total.errorMax);
+	printf("%d frames, detection %.1f frames/s, with decoding %.1f frames/s, peak memory %.1f MB\n",
+		frames, detectSeconds > 0 ? frames / detectSeconds : 0, totalSeconds > 0 ? frames / totalSeconds : 0, peakMb);
+
+	ofstream out(reportPath, ios::out | ios::trunc);
+	out << "{\n\"video\":" << jsonString(args[0]) << ",\n\"truth\":" << jsonString(args[1]) << ",\n\"config\":" << jsonString(configPath)
+		<< ",\n\"settings\":{\"scale\":" << settings.scale << ",\"step\":" << settings.step << ",\"search_margin\":" << settings.searchMargin
+		<< ",\"classifier\":\"" << (settings.useLut ? "lut" : "distance") << "\"}"
+		<< ",\n\"frames\":" << frames
+		<< ",\n\"detect_fps\":" << (detectSeconds > 0 ? frames / detectSeconds : 0)
+		<< ",\n\"fps\":" << (totalSeconds > 0 ? frames / totalSeconds : 0)
+		<< ",\n\"peak_memory_mb\":" << peakMb
+		<< ",\n\"markers\":[\n";
+	for (size_t i = 0; i < scores.size(); i++) {
+		out << "{\"name\":" << jsonString(config.names[i]) << ",";
+		writeScore(out, scores[i]);
+		out << "}" << (i + 1 < scores.size() ? ",\n" : "\n");
+	}
+	out << "],\n\"total\":{";
+	writeScore(out, total);
+	out << "}\n}\n";
+	out.close();
+	if (out.fail()) {
+		cerr << "Error writing " << reportPath << endl;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,62 @@
+#include "GroundTruth.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+#include "../RoundPenConfigurator/MarkerConfig.h"
+
+using namespace std;
+
+std::string formatGroundTruth(const GroundTruth& truth)
+{
+	ostringstream out;
+	for (size_t frame = 0; frame < truth.size(); frame++) {
+		for (size_t i = 0; i < truth[frame].size(); i++) {
+			const GroundTruthMarker& m = truth[frame][i];
+			out << frame << ";" << m.marker << ";" << m.center.x << ";" << m.center.y << ";" << m.radius << "\n";
+		}
+	}
+	return out.str();
+}
+
+bool writeGroundTruth(const char* path, const GroundTruth& truth)
+{
+	return writeFileAtomic(path, formatGroundTruth(truth));
+}
+
+bool readGroundTruth(const char* path, GroundTruth& truth)
+{
+	ifstream in(path);
+	if (!in.is_open()) {
+		return false;
+	}
+	truth.clear();
+	string line;
+	while (getline(in, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		istringstream fields(line);
+		string field[5];
+		for (int i = 0; i < 5; i++) {
+			if (!getline(fields, field[i], ';')) {
+				return false;
+			}
+		}
+		long frame = strtol(field[0].c_str(), NULL, 10);
+		if (frame < 0) {
+			return false;
+		}
+		GroundTruthMarker m;
+		m.marker = (int)strtol(field[1].c_str(), NULL, 10);
+		m.center.x = (float)strtod(field[2].c_str(), NULL);
+		m.center.y = (float)strtod(field[3].c_str(), NULL);
+		m.radius = (float)strtod(field[4].c_str(), NULL);
+		if ((size_t)frame >= truth.size()) {
+			truth.resize(frame + 1);
+		}
+		truth[frame].push_back(m);
+	}
+	return true;
+}
@@ -0,0 +1,25 @@
+#ifndef GROUNDTRUTH_H
+#define GROUNDTRUTH_H
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+// Known position of one marker in one frame.
+struct GroundTruthMarker {
+	// Index into the markers of markers.csv, starting with 0.
+	int marker;
+	// Centre in full resolution video coordinates.
+	cv::Point2f center;
+	float radius;
+};
+
+// Markers of every frame of a video, indexed by frame number.
+typedef std::vector<std::vector<GroundTruthMarker> > GroundTruth;
+
+// One line "frame;marker;x;y;radius" per marker and frame, in frame order.
+std::string formatGroundTruth(const GroundTruth& truth);
+bool writeGroundTruth(const char* path, const GroundTruth& truth);
+bool readGroundTruth(const char* path, GroundTruth& truth);
+
+#endif // GROUNDTRUTH_H
@@ -0,0 +1,174 @@
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../RoundPenConfigurator/MarkerConfig.h"
+#include "GroundTruth.h"
+#include "SynthScene.h"
+
+using namespace std;
+
+static void usage()
+{
+	cerr << "Usage: RoundPenSynth <video> [--size=1920x1080] [--fps=30] [--frames=300] [--markers=4] [--radius=12]" << endl
+		<< "       [--background=H,S,V] [--noise=4] [--blur=3] [--drift=0.1] [--seed=N] [--fourcc=MJPG]" << endl
+		<< "Writes the video, <video>.truth.csv with the marker positions and markers.csv, .hist and .bin next to it." << endl;
+}
+
+// Value of "--name=value", null if arg is another option.
+static const char* optionValue(const char* arg, const char* name)
+{
+	size_t length = strlen(name);
+	if (strncmp(arg, name, length) == 0 && arg[length] == '=') {
+		return arg + length + 1;
+	}
+	return NULL;
+}
+
+// Parses up to count integers separated by any single character, e.g. "1920x1080" or "0,0,90".
+static bool parseInts(const char* text, int* values, int count)
+{
+	for (int i = 0; i < count; i++) {
+		char* end;
+		values[i] = (int)strtol(text, &end, 10);
+		if (end == text || (i + 1 < count ? *end == '\0' : *end != '\0')) {
+			return false;
+		}
+		text = end + 1;
+	}
+	return true;
+}
+
+static bool parseDouble(const char* text, double& value)
+{
+	char* end;
+	value = strtod(text, &end);
+	return end != text && *end == '\0';
+}
+
+static bool parseOption(const char* arg, SynthSettings& settings, string& fourcc)
+{
+	const char* value;
+	int ints[3];
+	double number;
+	if ((value = optionValue(arg, "--size")) != NULL) {
+		if (!parseInts(value, ints, 2) || ints[0] <= 0 || ints[1] <= 0) {
+			return false;
+		}
+		settings.size = cv::Size(ints[0], ints[1]);
+	}
+	else if ((value = optionValue(arg, "--background")) != NULL) {
+		if (!parseInts(value, ints, 3) || ints[0] < 0 || ints[0] > 179 || ints[1] < 0 || ints[1] > 255 || ints[2] < 0 || ints[2] > 255) {
+			return false;
+		}
+		settings.backgroundHsv = cv::Vec3b((uchar)ints[0], (uchar)ints[1], (uchar)ints[2]);
+	}
+	else if ((value = optionValue(arg, "--fourcc")) != NULL) {
+		if (strlen(value) != 4) {
+			return false;
+		}
+		fourcc = value;
+	}
+	else if ((value = optionValue(arg, "--seed")) != NULL) {
+		char* end;
+		settings.seed = strtoull(value, &end, 0);
+		return end != value && *end == '\0';
+	}
+	else {
+		const char* intNames[] = { "--frames", "--markers", "--radius", "--blur" };
+		int* intValues[] = { &settings.frames, &settings.markers, &settings.radius, &settings.blur };
+		for (int i = 0; i < 4; i++) {
+			if ((value = optionValue(arg, intNames[i])) != NULL) {
+				if (!parseInts(value, ints, 1) || ints[0] < 0) {
+					return false;
+				}
+				*intValues[i] = ints[0];
+				return true;
+			}
+		}
+		const char* doubleNames[] = { "--fps", "--noise", "--drift" };
+		double* doubleValues[] = { &settings.fps, &settings.noise, &settings.drift };
+		for (int i = 0; i < 3; i++) {
+			if ((value = optionValue(arg, doubleNames[i])) != NULL) {
+				if (!parseDouble(value, number) || number < 0) {
+					return false;
+				}
+				*doubleValues[i] = number;
+				return true;
+			}
+		}
+		return false;
+	}
+	return true;
+}
+
+// Renders a video with markers on known trajectories, so throughput and
+// accuracy can be measured without real recordings.
+int main(int argc, char** argv)
+{
+	SynthSettings settings;
+	string fourcc = "MJPG";
+	const char* videoPath = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--", 2) != 0) {
+			videoPath = argv[i];
+		}
+		else if (!parseOption(argv[i], settings, fourcc)) {
+			cerr << "Invalid option " << argv[i] << endl;
+			usage();
+			return -1;
+		}
+	}
+	if (videoPath == NULL || settings.fps <= 0 || settings.markers > 255) {
+		usage();
+		return -1;
+	}
+
+	// Outputs next to the video.
+	string video = videoPath;
+	size_t slash = video.find_last_of("/\\");
+	string directory = slash == string::npos ? "" : video.substr(0, slash + 1);
+	size_t dot = video.find_last_of('.');
+	string base = dot == string::npos || (slash != string::npos && dot < slash) ? video : video.substr(0, dot);
+
+	SynthScene scene(settings);
+
+	MarkerConfig config;
+	scene.toConfig(config);
+	string configBase = directory + "markers";
+	if (!writeCsv((configBase + ".csv").c_str(), config) || !writeHistograms((configBase + ".hist").c_str(), config)
+		|| !writeBinary((configBase + ".bin").c_str(), config)) {
+		cerr << "Error writing " << configBase << ".csv, .hist and .bin" << endl;
+		return -1;
+	}
+
+	cv::VideoWriter writer(video, cv::VideoWriter::fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]), settings.fps, settings.size);
+	if (!writer.isOpened()) {
+		cerr << "Error opening " << video << " for writing" << endl;
+		return -1;
+	}
+
+	GroundTruth truth(settings.frames);
+	cv::Mat frame;
+	for (int i = 0; i < settings.frames; i++) {
+		scene.render(i, frame);
+		writer.write(frame);
+		scene.groundTruth(i, truth[i]);
+		if ((i + 1) % 100 == 0) {
+			cout << "Rendered " << i + 1 << " of " << settings.frames << " frames" << endl;
+		}
+	}
+	writer.release();
+
+	string truthPath = base + ".truth.csv";
+	if (!writeGroundTruth(truthPath.c_str(), truth)) {
+		cerr << "Error writing " << truthPath << endl;
+		return -1;
+	}
+	cout << "Wrote " << video << ", " << truthPath << " and " << configBase << ".csv" << endl;
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include "SynthScene.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+// Fractional bits of the coordinates passed to cv::circle.
+const int drawShift = 4;
+const double twoPi = 6.283185307179586;
+
+SynthSettings::SynthSettings() : size(1920, 1080), fps(30), frames(300), markers(4), radius(12),
+	backgroundHsv(0, 0, 90), noise(4), blur(3), drift(0.1), seed(0x5eed)
+{
+}
+
+static cv::Scalar hsvToBgr(const cv::Vec3b& hsv)
+{
+	cv::Mat pixel(1, 1, CV_8UC3, cv::Scalar(hsv[0], hsv[1], hsv[2]));
+	cv::cvtColor(pixel, pixel, cv::COLOR_HSV2BGR);
+	cv::Vec3b bgr = pixel.at<cv::Vec3b>(0, 0);
+	return cv::Scalar(bgr[0], bgr[1], bgr[2]);
+}
+
+SynthScene::SynthScene(const SynthSettings& settings) : settings(settings)
+{
+	CV_Assert(settings.markers >= 0 && settings.markers < 256);
+	cv::RNG rng(settings.seed);
+	backgroundBgr = hsvToBgr(settings.backgroundHsv);
+
+	const float radius = std::max(2.0f, settings.radius * settings.size.height / 1080.0f);
+	const float width = (float)settings.size.width;
+	const float height = (float)settings.size.height;
+	for (int i = 0; i < settings.markers; i++) {
+		SynthMarker m;
+		char name[32];
+		snprintf(name, sizeof(name), "Marker %d", i + 1);
+		m.name = name;
+		// Hues evenly spread so the markers can be told apart.
+		int hue = (i * 180 / std::max(1, settings.markers) + rng.uniform(0, 10)) % 180;
+		m.hsv = cv::Vec3b((uchar)hue, (uchar)rng.uniform(180, 256), (uchar)rng.uniform(160, 256));
+		m.radius = radius;
+		m.center = cv::Point2f(width * (float)rng.uniform(0.3, 0.7), height * (float)rng.uniform(0.3, 0.7));
+		// Stays completely inside the frame.
+		float reachX = std::min(m.center.x, width - m.center.x) - radius - 2;
+		float reachY = std::min(m.center.y, height - m.center.y) - radius - 2;
+		m.amplitude = cv::Point2f(std::max(0.0f, reachX) * (float)rng.uniform(0.4, 1.0), std::max(0.0f, reachY) * (float)rng.uniform(0.4, 1.0));
+		// One period takes 3 to 10 seconds.
+		m.frequency = cv::Point2f((float)(1 / (settings.fps * rng.uniform(3.0, 10.0))), (float)(1 / (settings.fps * rng.uniform(3.0, 10.0))));
+		m.phase = cv::Point2f((float)rng.uniform(0.0, twoPi), (float)rng.uniform(0.0, twoPi));
+		markers.push_back(m);
+		markerBgr.push_back(hsvToBgr(m.hsv));
+	}
+}
+
+cv::Point2f SynthScene::position(int marker, int frame) const
+{
+	const SynthMarker& m = markers[marker];
+	return cv::Point2f(m.center.x + m.amplitude.x * (float)sin(twoPi * m.frequency.x * frame + m.phase.x),
+		m.center.y + m.amplitude.y * (float)sin(twoPi * m.frequency.y * frame + m.phase.y));
+}
+
+void SynthScene::groundTruth(int frame, std::vector<GroundTruthMarker>& truth) const
+{
+	truth.clear();
+	for (size_t i = 0; i < markers.size(); i++) {
+		GroundTruthMarker m;
+		m.marker = (int)i;
+		m.center = position((int)i, frame);
+		m.radius = markers[i].radius;
+		truth.push_back(m);
+	}
+}
+
+void SynthScene::draw(int frame, bool withMarkers, cv::Mat& bgr) const
+{
+	bgr.create(settings.size, CV_8UC3);
+	bgr.setTo(backgroundBgr);
+	if (!withMarkers) {
+		return;
+	}
+	for (size_t i = 0; i < markers.size(); i++) {
+		// Sub pixel positions, so the ground truth is exact.
+		cv::Point2f p = position((int)i, frame);
+		cv::Point center(cvRound(p.x * (1 << drawShift)), cvRound(p.y * (1 << drawShift)));
+		cv::circle(bgr, center, cvRound(markers[i].radius * (1 << drawShift)), markerBgr[i], cv::FILLED, cv::LINE_AA, drawShift);
+	}
+}
+
+void SynthScene::applyEffects(int frame, cv::Mat& bgr)
+{
+	if (settings.blur > 0) {
+		int k = settings.blur | 1;
+		cv::GaussianBlur(bgr, bgr, cv::Size(k, k), 0);
+	}
+	double gain = 1;
+	if (settings.frames > 0) {
+		gain += settings.drift * sin(twoPi * frame / settings.frames);
+	}
+	if (settings.noise <= 0) {
+		if (gain != 1) {
+			bgr.convertTo(bgr, CV_8UC3, gain);
+		}
+		return;
+	}
+	bgr.convertTo(wide, CV_16SC3, gain);
+	cv::RNG rng(settings.seed ^ ((uint64_t)(frame + 1) * 0x9e3779b97f4a7c15ULL));
+	noise.create(settings.size, CV_16SC3);
+	rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(settings.noise));
+	wide += noise;
+	wide.convertTo(bgr, CV_8UC3);
+}
+
+void SynthScene::render(int frame, cv::Mat& bgr)
+{
+	draw(frame, true, bgr);
+	applyEffects(frame, bgr);
+}
+
+void SynthScene::toConfig(MarkerConfig& config)
+{
+	config = MarkerConfig();
+	config.roi = cv::Rect(cv::Point(0, 0), settings.size);
+	const cv::Rect frameRect = config.roi;
+
+	// Background from a frame without markers, so no marker pixel gets in.
+	cv::Mat bgr;
+	cv::Mat hsv;
+	draw(0, false, bgr);
+	applyEffects(0, bgr);
+	cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+	cv::Point middle(settings.size.width / 2, settings.size.height / 2);
+	config.backgroundColor = hsv.at<cv::Vec3b>(middle);
+	config.backgroundModel.addPatch(hsv(cv::Rect(middle - cv::Point(32, 32), cv::Size(64, 64)) & frameRect));
+
+	render(0, bgr);
+	cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+	for (size_t i = 0; i < markers.size(); i++) {
+		// Like a click into the marker, sampling the inner half of it.
+		cv::Point2f p = position((int)i, 0);
+		cv::Point center(cvRound(p.x), cvRound(p.y));
+		int half = std::max(1, cvRound(markers[i].radius / 2));
+		config.names.push_back(markers[i].name);
+		config.colors.push_back(hsv.at<cv::Vec3b>(center));
+		config.models.push_back(HistogramModel());
+		config.models.back().addPatch(hsv(cv::Rect(center.x - half, center.y - half, 2 * half + 1, 2 * half + 1) & frameRect));
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef SYNTHSCENE_H
+#define SYNTHSCENE_H
+
+#include <opencv2/core/core.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../RoundPenConfigurator/MarkerConfig.h"
+#include "GroundTruth.h"
+
+// Everything that defines a generated video. The same settings always
+// render the same frames.
+struct SynthSettings {
+	SynthSettings();
+
+	cv::Size size;
+	double fps;
+	int frames;
+	int markers;
+	// Marker radius in pixels at 1920x1080, scaled with the height.
+	int radius;
+	cv::Vec3b backgroundHsv;
+	// Standard deviation of the per pixel noise.
+	double noise;
+	// Gaussian blur kernel size, 0 for none.
+	int blur;
+	// Brightness goes up and down by this fraction over the video.
+	double drift;
+	uint64_t seed;
+};
+
+// One marker moving on a Lissajous curve.
+struct SynthMarker {
+	std::string name;
+	cv::Vec3b hsv;
+	cv::Point2f center;
+	cv::Point2f amplitude;
+	// Periods per frame in x and y.
+	cv::Point2f frequency;
+	cv::Point2f phase;
+	float radius;
+};
+
+// Renders a background with round markers moving on known trajectories.
+class SynthScene {
+public:
+	explicit SynthScene(const SynthSettings& settings);
+
+	const SynthSettings& getSettings() const { return settings; }
+	const std::vector<SynthMarker>& getMarkers() const { return markers; }
+
+	cv::Point2f position(int marker, int frame) const;
+	// Positions of all markers in a frame.
+	void groundTruth(int frame, std::vector<GroundTruthMarker>& truth) const;
+
+	// Renders a BGR frame including blur, lighting drift and noise.
+	void render(int frame, cv::Mat& bgr);
+
+	// Colours and histograms as if sampled in the configurator from the
+	// first frame, with the whole frame as region of interest.
+	void toConfig(MarkerConfig& config);
+
+private:
+	void draw(int frame, bool withMarkers, cv::Mat& bgr) const;
+	// Blur, lighting drift and noise. The noise of a frame only depends on
+	// the seed and the frame number, so frames can be rendered in any order.
+	void applyEffects(int frame, cv::Mat& bgr);
+
+	SynthSettings settings;
+	std::vector<SynthMarker> markers;
+	cv::Scalar backgroundBgr;
+	std::vector<cv::Scalar> markerBgr;
+	cv::Mat noise;
+	cv::Mat wide;
+};
+
+#endif // SYNTHSCENE_H
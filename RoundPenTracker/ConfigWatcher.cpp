@@ -0,0 +1,166 @@
+#include "ConfigWatcher.h"
+
+#include "../RoundPenConfigurator/Trace.h"
+
+#include <sstream>
+#include <string.h>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#if defined(__linux__)
+		#include <poll.h>
+		#include <sys/inotify.h>
+	#endif
+#endif
+
+// Longest wait for an event. Also bounds how long a missed event delays
+// a reload and how long the destructor waits for the thread.
+const int watchTimeoutMs = 100;
+
+// Identifies one version of the file. The writer replaces the file by a
+// rename, so a new version is also a new file.
+static std::string fileStamp(const std::string& path)
+{
+	std::ostringstream stamp;
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
+		return std::string();
+	}
+	stamp << data.nFileSizeHigh << ":" << data.nFileSizeLow << ":" << data.ftLastWriteTime.dwHighDateTime << ":" << data.ftLastWriteTime.dwLowDateTime << ":" << data.ftCreationTime.dwLowDateTime;
+#else
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) {
+		return std::string();
+	}
+	stamp << st.st_size << ":" << st.st_mtime << ":" << st.st_ino << ":" << st.st_dev;
+#endif
+	return stamp.str();
+}
+
+ConfigWatcher::ConfigWatcher(const std::string& path) : path(path), generation(0), stopping(false)
+{
+	size_t separator = path.find_last_of("/\\");
+	directory = separator == std::string::npos ? "." : path.substr(0, separator);
+	fileName = separator == std::string::npos ? path : path.substr(separator + 1);
+
+	// Watch the directory, not the file: every save replaces the file.
+#if defined(_WIN32)
+	changeHandle = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+#elif defined(__linux__)
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, directory.c_str(), IN_MOVED_TO | IN_CLOSE_WRITE | IN_CREATE) < 0) {
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+#endif
+
+	reloadIfChanged();
+	worker = std::thread(&ConfigWatcher::run, this);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+	stopping = true;
+	worker.join();
+#if defined(_WIN32)
+	if (changeHandle != INVALID_HANDLE_VALUE) {
+		FindCloseChangeNotification(changeHandle);
+	}
+#elif defined(__linux__)
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#endif
+}
+
+std::shared_ptr<const TrackerTables> ConfigWatcher::current() const
+{
+	return std::atomic_load(&tables);
+}
+
+void ConfigWatcher::run()
+{
+	traceThreadName("config watcher");
+	while (!stopping) {
+		waitForChange(watchTimeoutMs);
+		if (!stopping) {
+			reloadIfChanged();
+		}
+	}
+}
+
+void ConfigWatcher::waitForChange(int timeoutMs)
+{
+	// Events only wake the thread early. Whether the file really changed is
+	// decided by its stamp, so a missed or unrelated event does no harm.
+#if defined(_WIN32)
+	if (changeHandle != INVALID_HANDLE_VALUE) {
+		if (WaitForSingleObject(changeHandle, timeoutMs) == WAIT_OBJECT_0) {
+			FindNextChangeNotification(changeHandle);
+		}
+		return;
+	}
+	Sleep(timeoutMs);
+#else
+#if defined(__linux__)
+	if (inotifyFd >= 0) {
+		pollfd pfd;
+		pfd.fd = inotifyFd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, timeoutMs) > 0) {
+			char events[4096];
+			while (read(inotifyFd, events, sizeof(events)) > 0) {
+			}
+		}
+		return;
+	}
+#endif
+	usleep(timeoutMs * 1000);
+#endif
+}
+
+bool loadTrackerTables(const std::string& path, TrackerTables& tables)
+{
+	try {
+		{
+			MappedMarkerConfig mapped;
+			if (!mapped.open(path.c_str())) {
+				return false;
+			}
+			mapped.toConfig(tables.config);
+			tables.lut.minProbability = tables.config.minProbability;
+			tables.lut.minValue = tables.config.minValue;
+			memcpy(&tables.lut.table[0], mapped.lut(), tables.lut.table.size());
+		}
+		tables.config.applyTo(tables.classifier);
+	}
+	catch (const cv::Exception&) {
+		// open() checks what the classifier asserts, this only guards against files it misses.
+		return false;
+	}
+	return true;
+}
+
+void ConfigWatcher::reloadIfChanged()
+{
+	std::string stamp = fileStamp(path);
+	if (stamp.empty() || stamp == lastStamp) {
+		return;
+	}
+	TRACE_SCOPE("reload");
+
+	// On the watcher thread, nothing may throw out of here and end the tracker.
+	std::shared_ptr<TrackerTables> loaded = std::make_shared<TrackerTables>();
+	if (!loadTrackerTables(path, *loaded)) {
+		return;
+	}
+	loaded->generation = ++generation;
+	std::atomic_store(&tables, std::shared_ptr<const TrackerTables>(loaded));
+	lastStamp = stamp;
+}
@@ -0,0 +1,72 @@
+#ifndef CONFIGWATCHER_H
+#define CONFIGWATCHER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+#include "../RoundPenConfigurator/HistogramModel.h"
+#include "../RoundPenConfigurator/MarkerClassifier.h"
+#include "../RoundPenConfigurator/MarkerConfig.h"
+
+// Everything a tracker needs from one version of markers.bin.
+// Never changed after it is published, a new version is a new object.
+struct TrackerTables {
+	MarkerConfig config;
+	MarkerClassifier classifier;
+	BackProjectionLut lut;
+	// Counts the loaded versions, starting with 1.
+	uint64_t generation;
+};
+
+// Loads markers.bin into tables, with the precomputed lookup table of the
+// file. The file is unmapped again before returning, so the configurator
+// can replace it at any time. False if the file is missing or invalid,
+// tables are then left half filled.
+bool loadTrackerTables(const std::string& path, TrackerTables& tables);
+
+// Watches a markers.bin and loads every new version on a background thread.
+// Readers take current() once per frame and keep using that version for the
+// whole frame. The watcher swaps in new versions atomically and an old
+// version is freed once the last frame using it has dropped it, so frames
+// neither wait for a reload nor see half of one.
+class ConfigWatcher {
+public:
+	// Loads the file once before returning, if it exists.
+	explicit ConfigWatcher(const std::string& path);
+	~ConfigWatcher();
+
+	// Latest loaded version, null as long as no valid file was found.
+	std::shared_ptr<const TrackerTables> current() const;
+
+private:
+	ConfigWatcher(const ConfigWatcher&);
+	ConfigWatcher& operator=(const ConfigWatcher&);
+
+	void run();
+	// Waits for a change in the directory of the file or for the timeout.
+	void waitForChange(int timeoutMs);
+	// Loads the file if its size, time or identity changed since the last
+	// successful load. A failed load keeps the current version and is tried
+	// again on the next wake up, e.g. when a copy was not complete yet.
+	void reloadIfChanged();
+
+	std::string path;
+	std::string directory;
+	std::string fileName;
+	// Size, modification time and file identity of the last successful load.
+	std::string lastStamp;
+	uint64_t generation;
+	std::shared_ptr<const TrackerTables> tables;
+	std::atomic<bool> stopping;
+#if defined(_WIN32)
+	void* changeHandle;
+#elif defined(__linux__)
+	int inotifyFd;
+#endif
+	std::thread worker;
+};
+
+#endif // CONFIGWATCHER_H
@@ -0,0 +1,91 @@
+#include "MarkerDetector.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+#include "../RoundPenConfigurator/Trace.h"
+
+DetectorSettings::DetectorSettings() : scale(1), step(1), searchMargin(0), useLut(true)
+{
+}
+
+MarkerDetector::MarkerDetector(const DetectorSettings& settings) : settings(settings), lastMarkers(0)
+{
+	CV_Assert(settings.scale > 0 && settings.scale <= 1 && settings.step >= 1 && settings.searchMargin >= 0);
+}
+
+void MarkerDetector::reset()
+{
+	last.clear();
+	lastMarkers = 0;
+}
+
+void MarkerDetector::detect(const cv::Mat& frame, const TrackerTables& tables, std::vector<DetectedMarker>& found)
+{
+	const MarkerConfig& config = tables.config;
+	found.clear();
+
+	cv::Rect roi(0, 0, frame.cols, frame.rows);
+	if (config.roi.area() > 0 && (config.roi & roi) == config.roi) {
+		roi = config.roi;
+	}
+	searched = roi;
+	if (settings.searchMargin > 0 && lastMarkers == config.names.size() && last.size() == lastMarkers && !last.empty()) {
+		cv::Rect box(cv::Point(cvFloor(last[0].center.x), cvFloor(last[0].center.y)), cv::Size(1, 1));
+		for (size_t i = 1; i < last.size(); i++) {
+			box |= cv::Rect(cv::Point(cvFloor(last[i].center.x), cvFloor(last[i].center.y)), cv::Size(1, 1));
+		}
+		int margin = settings.searchMargin;
+		searched = cv::Rect(box.x - margin, box.y - margin, box.width + 2 * margin, box.height + 2 * margin) & roi;
+	}
+
+	// Full resolution pixels per classified pixel.
+	const double factor = settings.step / settings.scale;
+	{
+		TRACE_SCOPE("cvtColor");
+		if (factor == 1) {
+			cv::cvtColor(frame(searched), hsv, cv::COLOR_BGR2HSV);
+		}
+		else {
+			// Plain subsampling picks single pixels, a lower scale averages them.
+			cv::Size size(std::max(1, cvRound(searched.width / factor)), std::max(1, cvRound(searched.height / factor)));
+			cv::resize(frame(searched), small, size, 0, 0, settings.scale == 1 ? cv::INTER_NEAREST : cv::INTER_AREA);
+			cv::cvtColor(small, hsv, cv::COLOR_BGR2HSV);
+		}
+	}
+	{
+		TRACE_SCOPE("classify");
+		if (settings.useLut) {
+			tables.lut.classify(hsv, labels);
+		}
+		else {
+			tables.classifier.classify(hsv, labels);
+		}
+	}
+
+	TRACE_SCOPE("markers");
+	const double scaleX = searched.width / (double)hsv.cols;
+	const double scaleY = searched.height / (double)hsv.rows;
+	const size_t minArea = std::max((size_t)1, (size_t)(minMarkerArea / (scaleX * scaleY)));
+	// Only the markers of this configuration, masks may be left from a larger one.
+	const int count = (int)config.names.size();
+	BitMask::fromLabels(labels, count, masks);
+	for (int i = 0; i < count; i++) {
+		BitMask::open(masks[i], masks[i]);
+		// Straight from the packed bits, no 8-bit copy of the mask.
+		double sumX;
+		double sumY;
+		size_t area = masks[i].moments(sumX, sumY);
+		if (area < minArea) {
+			continue;
+		}
+		DetectedMarker marker;
+		marker.marker = i;
+		// Pixel centres, so a subsampled pixel stands for the middle of its block.
+		marker.center = cv::Point2f((float)((sumX / area + 0.5) * scaleX - 0.5 + searched.x), (float)((sumY / area + 0.5) * scaleY - 0.5 + searched.y));
+		marker.area = (size_t)(area * scaleX * scaleY);
+		found.push_back(marker);
+	}
+	last = found;
+	lastMarkers = config.names.size();
+}
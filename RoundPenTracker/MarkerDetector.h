@@ -0,0 +1,65 @@
+#ifndef MARKERDETECTOR_H
+#define MARKERDETECTOR_H
+
+#include <opencv2/core/core.hpp>
+#include <stddef.h>
+#include <vector>
+
+#include "../RoundPenConfigurator/BitMask.h"
+#include "ConfigWatcher.h"
+
+// Markers smaller than this many full resolution pixels after opening are ignored.
+const size_t minMarkerArea = 20;
+
+// How a frame is searched. The defaults look at every pixel of the region of
+// interest, the other settings trade accuracy for speed.
+struct DetectorSettings {
+	DetectorSettings();
+
+	// Resizes the region of interest by this factor before classifying it.
+	double scale;
+	// Only classifies every step-th pixel in x and y.
+	int step;
+	// Only searches the box around the markers of the last frame, grown by
+	// this many full resolution pixels. 0 searches the whole region of
+	// interest. Falls back to the whole region whenever a marker was lost.
+	int searchMargin;
+	// Back-projection table if true, the distance classifier otherwise.
+	bool useLut;
+};
+
+struct DetectedMarker {
+	// Index into the markers of the configuration, starting with 0.
+	int marker;
+	// Centre in full resolution video coordinates.
+	cv::Point2f center;
+	// Size in full resolution pixels.
+	size_t area;
+};
+
+// Finds the markers of a configuration in a video frame: classifies the
+// region of interest, opens the mask of every marker and takes the centroid.
+class MarkerDetector {
+public:
+	explicit MarkerDetector(const DetectorSettings& settings = DetectorSettings());
+
+	// Forgets the markers of the last frame, e.g. after a seek.
+	void reset();
+
+	void detect(const cv::Mat& frame, const TrackerTables& tables, std::vector<DetectedMarker>& found);
+
+	// Part of the last frame that was searched.
+	cv::Rect getSearched() const { return searched; }
+
+private:
+	DetectorSettings settings;
+	cv::Rect searched;
+	std::vector<DetectedMarker> last;
+	size_t lastMarkers;
+	cv::Mat small;
+	cv::Mat hsv;
+	cv::Mat labels;
+	std::vector<BitMask> masks;
+};
+
+#endif // MARKERDETECTOR_H
@@ -0,0 +1,90 @@
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <vector>
+
+#include "../RoundPenConfigurator/PooledMatAllocator.h"
+#include "../RoundPenConfigurator/Trace.h"
+#include "ConfigWatcher.h"
+#include "MarkerDetector.h"
+
+using namespace std;
+
+// Tracks the markers of a markers.bin in a video. Saving in the
+// configurator while this runs updates the colours without a restart.
+int main(int argc, char** argv)
+{
+	traceFromArgs(argc, argv);
+	traceThreadName("main");
+	// Frame buffers are reused from frame to frame instead of going back to the heap.
+	PooledMatAllocator::instance().install();
+
+	// Positional arguments, options start with --.
+	vector<const char*> args;
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--", 2) != 0) {
+			args.push_back(argv[i]);
+		}
+	}
+	if (args.empty()) {
+		cerr << "Usage: RoundPenTracker <video> [markers.bin] [--trace[=trace.json]]" << endl;
+		return -1;
+	}
+	const char* configPath = args.size() > 1 ? args[1] : "markers.bin";
+
+	cv::VideoCapture cap(args[0]);
+	if (!cap.isOpened()) {
+		cerr << "Error opening video" << endl;
+		return -1;
+	}
+
+	ConfigWatcher watcher(configPath);
+	uint64_t generation = 0;
+	MarkerDetector detector;
+
+	cv::Mat frame;
+	vector<DetectedMarker> found;
+	while (true) {
+		TRACE_SCOPE("frame");
+		{
+			TRACE_SCOPE("decode");
+			if (!cap.read(frame)) {
+				break;
+			}
+		}
+		// One version of the tables for the whole frame, even if a new one
+		// is loaded meanwhile.
+		shared_ptr<const TrackerTables> tables = watcher.current();
+		if (!tables) {
+			cv::putText(frame, "Waiting for " + string(configPath), cv::Point(15, 15), cv::FONT_HERSHEY_PLAIN, 1, CV_RGB(255, 0, 0), 2);
+		}
+		else {
+			const MarkerConfig& config = tables->config;
+			if (tables->generation != generation) {
+				generation = tables->generation;
+				cout << "Loaded configuration " << generation << " with " << config.names.size() << " markers" << endl;
+			}
+
+			detector.detect(frame, *tables, found);
+			for (size_t i = 0; i < found.size(); i++) {
+				cv::Point center(cvRound(found[i].center.x), cvRound(found[i].center.y));
+				cv::circle(frame, center, 6, cv::Scalar(255, 255, 255), 2);
+				cv::putText(frame, config.names[found[i].marker], center + cv::Point(10, -10), cv::FONT_HERSHEY_PLAIN, 1, CV_RGB(255, 255, 255), 1);
+			}
+			cv::rectangle(frame, detector.getSearched(), cv::Scalar(0, 0, 255), 1);
+		}
+
+		{
+			TRACE_SCOPE("imshow");
+			cv::imshow("RoundPen Tracker", frame);
+		}
+		if (cv::waitKey(1) == 27) {
+			break;
+		}
+	}
+	return 0;
+}